@@ -0,0 +1,27 @@
+#!/bin/bash
+# Copy a prebuilt BPF object out of the object cache, verifying that the
+# .bpf.c source still matches the hash the cache entry was keyed by at
+# configure time. CO-RE makes the objects portable, but a stale copy of a
+# since-edited source must never be used silently.
+
+set -e
+
+CACHED_OBJECT="$1"
+BPF_SOURCE="$2"
+EXPECTED_HASH="$3"
+OUTPUT_OBJECT="$4"
+
+if [ -z "$OUTPUT_OBJECT" ]; then
+    echo "Usage: $0 <cached_object> <bpf_source> <expected_hash> <output_object>" >&2
+    exit 1
+fi
+
+ACTUAL_HASH=$(sha256sum "$BPF_SOURCE" | cut -c1-16)
+
+if [ "$ACTUAL_HASH" != "$EXPECTED_HASH" ]; then
+    echo "Error: $BPF_SOURCE changed since configure (hash $ACTUAL_HASH != $EXPECTED_HASH)." >&2
+    echo "Re-run cmake so the BPF object cache lookup is refreshed." >&2
+    exit 1
+fi
+
+cp "$CACHED_OBJECT" "$OUTPUT_OBJECT"
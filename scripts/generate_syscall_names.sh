@@ -73,6 +73,51 @@ static inline const char *get_syscall_name(unsigned int nr)
     return "unknown";
 }
 
+// Per-syscall category bitmask for kernel-side filtering. The loader
+// copies this table into the tracer's syscall_categories array map so the
+// BPF program can drop uninteresting syscalls with one array index.
+// Uncategorized syscalls carry 0 and never match an enabled category.
+#define SYSCALL_CAT_IO 0x01    // File and descriptor I/O, fs metadata, epoll/aio
+#define SYSCALL_CAT_NET 0x02   // Sockets and socket I/O
+#define SYSCALL_CAT_MEM 0x04   // Address space and memory policy
+#define SYSCALL_CAT_IPC 0x08   // Pipes, SysV/POSIX IPC, futex, signals between processes
+#define SYSCALL_CAT_SCHED 0x10 // Scheduling, process lifecycle, sleeps
+
+EOF
+
+echo "Generating syscall category table..."
+
+echo "static const unsigned char syscall_categories[] = {" >> "$OUTPUT_FILE"
+
+ausyscall --dump | awk '
+function categorize(name,    c) {
+    c = 0
+    if (name ~ /^(read|write|open|openat|openat2|close|close_range|creat|lseek|pread64|pwrite64|readv|writev|preadv|pwritev|preadv2|pwritev2|sendfile|splice|tee|vmsplice|copy_file_range|fsync|fdatasync|sync|syncfs|sync_file_range|stat|fstat|lstat|newfstatat|statx|getdents|getdents64|truncate|ftruncate|fallocate|rename|renameat|renameat2|link|linkat|unlink|unlinkat|mkdir|mkdirat|rmdir|symlink|symlinkat|readlink|readlinkat|chmod|fchmod|fchmodat|chown|fchown|lchown|fchownat|utime|utimes|utimensat|futimesat|access|faccessat|faccessat2|dup|dup2|dup3|fcntl|flock|ioctl|select|pselect6|poll|ppoll|epoll_create|epoll_create1|epoll_ctl|epoll_wait|epoll_pwait|epoll_pwait2|inotify_init|inotify_init1|inotify_add_watch|inotify_rm_watch|fanotify_init|fanotify_mark|io_setup|io_destroy|io_submit|io_cancel|io_getevents|io_pgetevents|io_uring_setup|io_uring_enter|io_uring_register|name_to_handle_at|open_by_handle_at|statfs|fstatfs|mount|umount2|move_mount|open_tree|fsopen|fsconfig|fsmount|fspick|quotactl|chdir|fchdir|getcwd|chroot|pivot_root)$/)
+        c += 1
+    if (name ~ /^(socket|socketpair|bind|listen|accept|accept4|connect|shutdown|send|sendto|sendmsg|sendmmsg|recv|recvfrom|recvmsg|recvmmsg|getsockname|getpeername|getsockopt|setsockopt)$/)
+        c += 2
+    if (name ~ /^(mmap|munmap|mremap|mprotect|madvise|process_madvise|brk|mlock|mlock2|munlock|mlockall|munlockall|mincore|msync|membarrier|memfd_create|memfd_secret|remap_file_pages|pkey_alloc|pkey_free|pkey_mprotect|userfaultfd|set_mempolicy|get_mempolicy|mbind|migrate_pages|move_pages)$/)
+        c += 4
+    if (name ~ /^(pipe|pipe2|shmget|shmat|shmdt|shmctl|semget|semop|semtimedop|semctl|msgget|msgsnd|msgrcv|msgctl|mq_open|mq_unlink|mq_timedsend|mq_timedreceive|mq_notify|mq_getsetattr|futex|futex_waitv|eventfd|eventfd2|signalfd|signalfd4|kill|tkill|tgkill|rt_sigqueueinfo|rt_tgsigqueueinfo|pidfd_open|pidfd_send_signal|pidfd_getfd|process_vm_readv|process_vm_writev)$/)
+        c += 8
+    if (name ~ /^(sched_yield|sched_setparam|sched_getparam|sched_setscheduler|sched_getscheduler|sched_get_priority_max|sched_get_priority_min|sched_rr_get_interval|sched_setaffinity|sched_getaffinity|sched_setattr|sched_getattr|nanosleep|clock_nanosleep|fork|vfork|clone|clone3|execve|execveat|exit|exit_group|wait4|waitid|setpriority|getpriority)$/)
+        c += 16
+    return c
+}
+/^[0-9]/ {
+    cat = categorize($2)
+    if (cat != 0) {
+        printf "    [%d] = 0x%02x, // %s\n", $1, cat, $2
+    }
+}
+' >> "$OUTPUT_FILE"
+
+echo "};" >> "$OUTPUT_FILE"
+
+cat >> "$OUTPUT_FILE" << 'EOF'
+
+#define SYSCALL_CATEGORIES_COUNT (sizeof(syscall_categories) / sizeof(syscall_categories[0]))
+
 #endif  // KERNELSIGHT_SYSCALL_NAMES_H
 EOF
 
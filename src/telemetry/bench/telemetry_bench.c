@@ -0,0 +1,453 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Microbenchmarks for the telemetry hot paths
+//
+// Measures the per-event cost of the code the loaders run at high rates:
+// JSON serialization, histogram percentile extraction, per-CPU stats
+// merging, the /proc parsers (against captured fixtures, so results are
+// comparable across hosts), and the shared-memory ring transport. One
+// JSON result line per benchmark on stdout, suitable for tracking
+// regressions per release:
+//
+//   {"benchmark":"syscall_serialize","iterations":...,"ops_per_sec":...}
+//
+// Build target: telemetry_bench (no eBPF dependencies).
+
+#include "../common/ipc_ring.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+#include "../sysfs/net_stats.h"
+#include "../sysfs/proc_scraper.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TASK_COMM_LEN 16
+#define BENCH_NR_CPUS 64
+
+// I/O latency sketch geometry (must match io_latency_tracer.bpf.c)
+#define IO_HIST_SUB_BITS 5
+#define IO_HIST_SUB (1 << IO_HIST_SUB_BITS)
+#define IO_HIST_MAX_EXP 22
+#define IO_HIST_SLOTS ((IO_HIST_MAX_EXP - IO_HIST_SUB_BITS + 1) * IO_HIST_SUB)
+
+#ifndef BENCH_FIXTURE_DIR
+#define BENCH_FIXTURE_DIR "fixtures"
+#endif
+
+// Synthetic syscall event matching the tracer's wire layout
+struct syscall_event {
+    unsigned long long timestamp;
+    unsigned int pid;
+    unsigned int tid;
+    unsigned int syscall_nr;
+    unsigned long long latency_ns;
+    long long ret_value;
+    unsigned long long arg0;
+    unsigned int cpu;
+    unsigned int uid;
+    unsigned char is_error;
+    char comm[TASK_COMM_LEN];
+};
+
+// Log-linear latency sketch, as used by the I/O latency tracer
+struct hist {
+    unsigned int slots[IO_HIST_SLOTS];
+};
+
+struct io_stats {
+    struct hist read_hist;
+    struct hist write_hist;
+    unsigned long long read_count;
+    unsigned long long write_count;
+    unsigned long long read_bytes;
+    unsigned long long write_bytes;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Emit one result line: name, iteration count, wall time, derived rate
+static void report(const char *name, uint64_t iterations, uint64_t elapsed_ns)
+{
+    char line[256];
+    struct json_writer jw;
+    double seconds = elapsed_ns / 1e9;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_str(&jw, "benchmark", name);
+    json_u64(&jw, "iterations", iterations);
+    json_double(&jw, "seconds", seconds, 4);
+    json_double(&jw, "ops_per_sec", seconds > 0 ? iterations / seconds : 0, 0);
+    json_double(&jw, "ns_per_op", iterations > 0 ? (double)elapsed_ns / iterations : 0, 1);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        printf("%s\n", line);
+    }
+}
+
+// Mirrors slot_lower_bound() in io_latency_tracer.c (static there)
+static double slot_lower_bound(int slot)
+{
+    if (slot < IO_HIST_SUB) {
+        return (double)slot;
+    }
+
+    int exp = (slot >> IO_HIST_SUB_BITS) + IO_HIST_SUB_BITS - 1;
+    int sub = slot & (IO_HIST_SUB - 1);
+
+    return (double)((unsigned long long)(IO_HIST_SUB + sub) << (exp - IO_HIST_SUB_BITS));
+}
+
+// Mirrors calculate_percentile() in io_latency_tracer.c (static there);
+// keep the two in sync so the measured instruction mix stays honest
+static double calculate_percentile(const struct hist *h, unsigned long long total,
+                                   double percentile)
+{
+    if (total == 0) {
+        return 0.0;
+    }
+
+    unsigned long long target = (unsigned long long)(total * percentile / 100.0);
+    unsigned long long cumulative = 0;
+
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
+        cumulative += h->slots[i];
+
+        if (cumulative >= target) {
+            return (slot_lower_bound(i) + slot_lower_bound(i + 1)) / 2.0;
+        }
+    }
+
+    return (double)(1ULL << IO_HIST_MAX_EXP);
+}
+
+// Mirrors merge_cpu_stats() in io_latency_tracer.c
+static void merge_cpu_stats(const struct io_stats *cpu_stats, unsigned int nr_cpus,
+                            struct io_stats *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+
+    for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+        const struct io_stats *s = &cpu_stats[cpu];
+        for (int i = 0; i < IO_HIST_SLOTS; i++) {
+            merged->read_hist.slots[i] += s->read_hist.slots[i];
+            merged->write_hist.slots[i] += s->write_hist.slots[i];
+        }
+        merged->read_count += s->read_count;
+        merged->write_count += s->write_count;
+        merged->read_bytes += s->read_bytes;
+        merged->write_bytes += s->write_bytes;
+    }
+}
+
+// Serialize synthetic syscall events through the same json_writer calls
+// handle_event() makes, into a null sink
+static void bench_syscall_serialize(void)
+{
+    const uint64_t iterations = 2000000;
+    struct syscall_event e = {
+        .timestamp = 1700000000123456789ULL,
+        .pid = 4242,
+        .tid = 4243,
+        .syscall_nr = 1,
+        .latency_ns = 125000,
+        .ret_value = 4096,
+        .arg0 = 3,
+        .cpu = 7,
+        .uid = 1000,
+        .is_error = 0,
+        .comm = "benchproc",
+    };
+    struct wire_writer wire;
+    char line[512];
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0 || wire_writer_init(&wire, null_fd, WIRE_FORMAT_JSON, 0, 100) < 0) {
+        fprintf(stderr, "ERROR: failed to set up null sink\n");
+        return;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        struct json_writer jw;
+        e.timestamp++;
+        json_writer_init(&jw, line, sizeof(line));
+        json_obj_begin(&jw, NULL);
+        json_u64(&jw, "timestamp", e.timestamp);
+        json_u64(&jw, "pid", e.pid);
+        json_u64(&jw, "tid", e.tid);
+        json_u64(&jw, "cpu", e.cpu);
+        json_u64(&jw, "uid", e.uid);
+        json_u64(&jw, "syscall", e.syscall_nr);
+        json_double(&jw, "latency_ms", e.latency_ns / 1000000.0, 3);
+        json_i64(&jw, "ret_value", e.ret_value);
+        json_bool(&jw, "is_error", e.is_error);
+        json_u64(&jw, "arg0", e.arg0);
+        json_str(&jw, "comm", e.comm);
+        json_obj_end(&jw);
+        int len = json_writer_finish(&jw);
+        if (len > 0) {
+            wire_write_json(&wire, line, len);
+        }
+    }
+    report("syscall_serialize", iterations, now_ns() - start);
+
+    wire_writer_destroy(&wire);
+    close(null_fd);
+}
+
+// Binary-mode equivalent: frame the raw event struct into the null sink
+static void bench_syscall_binary(void)
+{
+    const uint64_t iterations = 5000000;
+    struct syscall_event e = {.timestamp = 1700000000123456789ULL, .comm = "benchproc"};
+    struct wire_writer wire;
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0 || wire_writer_init(&wire, null_fd, WIRE_FORMAT_BINARY, 0, 100) < 0) {
+        fprintf(stderr, "ERROR: failed to set up null sink\n");
+        return;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        e.timestamp++;
+        wire_write_record(&wire, WIRE_REC_SYSCALL, &e, sizeof(e));
+    }
+    report("syscall_binary_frame", iterations, now_ns() - start);
+
+    wire_writer_destroy(&wire);
+    close(null_fd);
+}
+
+static void bench_percentile(void)
+{
+    const uint64_t iterations = 1000000;
+    struct hist h;
+    unsigned long long total = 0;
+    volatile double sink = 0;
+
+    // Roughly log-normal-shaped histogram across the sketch's octaves
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
+        int octave = i >> IO_HIST_SUB_BITS;
+        h.slots[i] = (unsigned int)(100000 >> (octave > 15 ? 15 : octave));
+        total += h.slots[i];
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += calculate_percentile(&h, total, 50.0);
+        sink += calculate_percentile(&h, total, 95.0);
+        sink += calculate_percentile(&h, total, 99.0);
+    }
+    report("percentile_p50_p95_p99", iterations, now_ns() - start);
+    (void)sink;
+}
+
+static void bench_merge_stats(void)
+{
+    const uint64_t iterations = 100000;
+    static struct io_stats cpu_stats[BENCH_NR_CPUS];
+    struct io_stats merged;
+
+    for (int cpu = 0; cpu < BENCH_NR_CPUS; cpu++) {
+        for (int i = 0; i < IO_HIST_SLOTS; i++) {
+            cpu_stats[cpu].read_hist.slots[i] = (unsigned int)(cpu + i);
+            cpu_stats[cpu].write_hist.slots[i] = (unsigned int)(cpu * i);
+        }
+        cpu_stats[cpu].read_count = 1000 + (unsigned long long)cpu;
+        cpu_stats[cpu].write_count = 500 + (unsigned long long)cpu;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        merge_cpu_stats(cpu_stats, BENCH_NR_CPUS, &merged);
+    }
+    report("merge_stats_64cpu", iterations, now_ns() - start);
+}
+
+// Load one fixture file into a malloc'd buffer; returns length or -1
+static ssize_t load_fixture(const char *name, char **out)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", BENCH_FIXTURE_DIR, name);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "ERROR: failed to open fixture %s\n", path);
+        return -1;
+    }
+
+    char *buf = malloc(65536);
+    if (!buf) {
+        fclose(fp);
+        return -1;
+    }
+    size_t len = fread(buf, 1, 65535, fp);
+    buf[len] = '\0';
+    fclose(fp);
+
+    *out = buf;
+    return (ssize_t)len;
+}
+
+static void bench_parse_meminfo(void)
+{
+    const uint64_t iterations = 200000;
+    char *fixture = NULL;
+    struct meminfo_metrics metrics;
+
+    if (load_fixture("meminfo.txt", &fixture) < 0) {
+        return;
+    }
+
+    // Split into lines once; parse_meminfo_line does not modify its input
+    char *lines[128];
+    int line_count = 0;
+    for (char *p = strtok(fixture, "\n"); p && line_count < 128; p = strtok(NULL, "\n")) {
+        lines[line_count++] = p;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        memset(&metrics, 0, sizeof(metrics));
+        for (int l = 0; l < line_count; l++) {
+            parse_meminfo_line(lines[l], &metrics);
+        }
+    }
+    report("parse_meminfo", iterations, now_ns() - start);
+
+    free(fixture);
+}
+
+static void bench_parse_loadavg(void)
+{
+    const uint64_t iterations = 1000000;
+    char *fixture = NULL;
+    struct loadavg_metrics metrics;
+
+    if (load_fixture("loadavg.txt", &fixture) < 0) {
+        return;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        parse_loadavg_line(fixture, &metrics);
+    }
+    report("parse_loadavg", iterations, now_ns() - start);
+
+    free(fixture);
+}
+
+static void bench_parse_net_dev(void)
+{
+    const uint64_t iterations = 200000;
+    char *fixture = NULL;
+    struct interface_stats iface;
+
+    ssize_t len = load_fixture("net_dev.txt", &fixture);
+    if (len < 0) {
+        return;
+    }
+
+    // parse_net_dev_line modifies the line in place, so re-copy the
+    // pristine fixture each iteration (the memcpy is part of the cost)
+    char *work = malloc((size_t)len + 1);
+    if (!work) {
+        free(fixture);
+        return;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(work, fixture, (size_t)len + 1);
+        int line_no = 0;
+        for (char *p = strtok(work, "\n"); p; p = strtok(NULL, "\n")) {
+            if (line_no++ < 2) {
+                continue; // Header lines
+            }
+            parse_net_dev_line(p, &iface);
+        }
+    }
+    report("parse_net_dev", iterations, now_ns() - start);
+
+    free(work);
+    free(fixture);
+}
+
+// End-to-end transport drain rate: producer frames events into the
+// shared-memory ring, consumer reads them back in place. This is the
+// replay-harness stand-in for a live BPF ring buffer drain.
+static void bench_ring_drain(void)
+{
+    const uint64_t iterations = 2000000;
+    const char *path = "/tmp/telemetry_bench.ring";
+    struct ipc_ring producer, consumer;
+    struct syscall_event e = {.timestamp = 1700000000123456789ULL, .comm = "benchproc"};
+    uint64_t consumed = 0;
+
+    if (ipc_ring_create(&producer, path, 4 * 1024 * 1024) != 0 ||
+        ipc_ring_open(&consumer, path) != 0) {
+        fprintf(stderr, "ERROR: failed to set up benchmark ring\n");
+        unlink(path);
+        return;
+    }
+
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        e.timestamp++;
+        if (ipc_ring_write(&producer, WIRE_REC_SYSCALL, &e, sizeof(e)) != 0) {
+            // Full: drain everything, then retry this event
+            uint8_t type;
+            uint32_t len;
+            while (ipc_ring_next(&consumer, &type, &len)) {
+                ipc_ring_advance(&consumer);
+                consumed++;
+            }
+            ipc_ring_write(&producer, WIRE_REC_SYSCALL, &e, sizeof(e));
+        }
+    }
+    {
+        uint8_t type;
+        uint32_t len;
+        while (ipc_ring_next(&consumer, &type, &len)) {
+            ipc_ring_advance(&consumer);
+            consumed++;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    if (consumed != iterations) {
+        fprintf(stderr, "WARNING: ring drain consumed %llu of %llu events\n",
+                (unsigned long long)consumed, (unsigned long long)iterations);
+    }
+    report("ring_write_drain", iterations, elapsed);
+
+    ipc_ring_close(&producer);
+    ipc_ring_close(&consumer);
+    unlink(path);
+}
+
+int main(void)
+{
+    bench_syscall_serialize();
+    bench_syscall_binary();
+    bench_percentile();
+    bench_merge_stats();
+    bench_parse_meminfo();
+    bench_parse_loadavg();
+    bench_parse_net_dev();
+    bench_ring_drain();
+    return 0;
+}
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Hot-path latency instrumentation implementation
+// See hotpath.h for the histogram layout and exposure paths.
+
+#include "hotpath.h"
+#include "json_writer.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef HAVE_SDT
+#include <sys/sdt.h>
+#endif
+
+#define HOTPATH_MAX_HISTS 16
+
+// Process-wide registry; loaders register a handful of probe points at
+// startup, so a fixed table avoids allocation on any path
+static struct hotpath_hist *registry[HOTPATH_MAX_HISTS];
+static int registry_count;
+
+// Cycle-to-time conversion for the JSON snapshot, calibrated once
+static double cycles_per_us;
+
+static int listen_fd = -1;
+static char socket_path[108];
+static pthread_t stats_thread;
+static volatile int stats_stop;
+
+// Measure the cycle counter against CLOCK_MONOTONIC over a short window;
+// TSCs on the supported hosts are invariant, so one calibration holds
+static void calibrate(void)
+{
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 10000000}; // 10ms
+    struct timespec t0, t1;
+    uint64_t c0, c1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = hotpath_cycles();
+    nanosleep(&ts, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    c1 = hotpath_cycles();
+
+    uint64_t elapsed_ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+                          (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+    if (elapsed_ns > 0 && c1 > c0) {
+        cycles_per_us = (double)(c1 - c0) * 1000.0 / (double)elapsed_ns;
+    } else {
+        cycles_per_us = 1000.0; // Fallback: treat counter as nanoseconds
+    }
+}
+
+int hotpath_register(struct hotpath_hist *h, const char *name)
+{
+    if (!h || registry_count >= HOTPATH_MAX_HISTS) {
+        return -1;
+    }
+
+    memset(h, 0, sizeof(*h));
+    h->name = name;
+    registry[registry_count++] = h;
+    return 0;
+}
+
+void hotpath_record(struct hotpath_hist *h, uint64_t start_cycles)
+{
+    uint64_t delta = hotpath_cycles() - start_cycles;
+
+    h->count++;
+    h->total_cycles += delta;
+    if (delta > h->max_cycles) {
+        h->max_cycles = delta;
+    }
+    // Bucket index = floor(log2(delta)); delta|1 keeps clzll defined
+    h->buckets[63 - __builtin_clzll(delta | 1)]++;
+
+#ifdef HAVE_SDT
+    // bpftrace: usdt:<binary>:kernelsight:hotpath_sample { @[str(arg0)] = hist(arg1); }
+    DTRACE_PROBE2(kernelsight, hotpath_sample, h->name, delta);
+#endif
+}
+
+// Approximate percentile from the log2 buckets: find the bucket holding
+// the target rank and report its midpoint. One-octave resolution is
+// enough to tell a 10us callback from a 10ms stall.
+static double percentile_us(const struct hotpath_hist *h, uint64_t count, double pct)
+{
+    if (count == 0) {
+        return 0.0;
+    }
+
+    uint64_t target = (uint64_t)(count * pct / 100.0);
+    uint64_t cumulative = 0;
+
+    for (int b = 0; b < HOTPATH_BUCKETS; b++) {
+        cumulative += h->buckets[b];
+        if (cumulative >= target) {
+            double mid_cycles = 1.5 * (double)(1ULL << b);
+            return mid_cycles / cycles_per_us;
+        }
+    }
+
+    return (double)h->max_cycles / cycles_per_us;
+}
+
+// Serialize one snapshot of every registered histogram. Counters may
+// advance mid-snapshot; each line is internally consistent enough for
+// forensics, which beats taking locks on the hot paths.
+static int build_snapshot(char *buf, size_t cap)
+{
+    struct json_writer jw;
+
+    json_writer_init(&jw, buf, cap);
+    json_obj_begin(&jw, NULL);
+    json_double(&jw, "cycles_per_us", cycles_per_us, 1);
+    json_obj_begin(&jw, "histograms");
+    for (int i = 0; i < registry_count; i++) {
+        const struct hotpath_hist *h = registry[i];
+        uint64_t count = h->count;
+        double avg_us = count ? (double)h->total_cycles / count / cycles_per_us : 0.0;
+
+        json_obj_begin(&jw, h->name);
+        json_u64(&jw, "count", count);
+        json_double(&jw, "avg_us", avg_us, 3);
+        json_double(&jw, "p50_us", percentile_us(h, count, 50.0), 3);
+        json_double(&jw, "p99_us", percentile_us(h, count, 99.0), 3);
+        json_double(&jw, "max_us", (double)h->max_cycles / cycles_per_us, 3);
+        json_obj_end(&jw);
+    }
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+
+    return json_writer_finish(&jw);
+}
+
+// Stats thread: one snapshot per accepted connection, then close. The
+// hot paths never touch this socket.
+static void *stats_main(void *arg)
+{
+    char buf[4096];
+
+    while (!stats_stop) {
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break; // Listen fd closed by hotpath_stats_close()
+        }
+
+        int len = build_snapshot(buf, sizeof(buf) - 1);
+        if (len > 0) {
+            buf[len] = '\n';
+            size_t off = 0;
+            while (off < (size_t)len + 1) {
+                ssize_t n = write(conn, buf + off, (size_t)len + 1 - off);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    break;
+                }
+                off += (size_t)n;
+            }
+        }
+        close(conn);
+    }
+
+    return NULL;
+}
+
+int hotpath_stats_listen(const char *path)
+{
+    struct sockaddr_un addr;
+
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ERROR: stats socket path too long\n");
+        return -1;
+    }
+
+    calibrate();
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        fprintf(stderr, "ERROR: cannot create stats socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path); // Replace a stale socket from a previous run
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 4) < 0) {
+        fprintf(stderr, "ERROR: cannot listen on stats socket '%s': %s\n", path,
+                strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    snprintf(socket_path, sizeof(socket_path), "%s", path);
+
+    if (pthread_create(&stats_thread, NULL, stats_main, NULL) != 0) {
+        fprintf(stderr, "ERROR: failed to start stats thread\n");
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void hotpath_stats_close(void)
+{
+    if (listen_fd < 0) {
+        return;
+    }
+
+    stats_stop = 1;
+    // shutdown() wakes the blocked accept(); close() alone does not on Linux
+    int fd = listen_fd;
+    listen_fd = -1;
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    pthread_join(stats_thread, NULL);
+    unlink(socket_path);
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Hot-path latency instrumentation for the collectors themselves
+//
+// Cycle-counter timings around the loaders' hot functions, aggregated
+// into in-process log2 histograms. Exposed two ways: USDT probes (when
+// built with systemtap-sdt-dev, so bpftrace can attach to our own
+// tracers in production) and a Unix-socket stats endpoint
+// (--stats-socket) that returns a JSON snapshot per connection. With
+// per-component p99s for callback duration, merge cost and write
+// stalls, "kernel dropped events", "loader was slow" and "consumer
+// backpressure" become distinguishable during incident forensics.
+
+#ifndef KERNELSIGHT_HOTPATH_H
+#define KERNELSIGHT_HOTPATH_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Power-of-two cycle buckets; 64 covers any 64-bit delta
+#define HOTPATH_BUCKETS 64
+
+// One instrumented code path. Updated from the hot thread without
+// locking; the stats thread takes torn-read-tolerant snapshots, which
+// is fine for monotonically growing counters.
+struct hotpath_hist {
+    const char *name;      // Probe point name, e.g. "handle_event"
+    uint64_t count;        // Samples recorded
+    uint64_t total_cycles; // Sum of all deltas
+    uint64_t max_cycles;   // Largest delta seen
+    uint64_t buckets[HOTPATH_BUCKETS]; // buckets[b] counts deltas in [2^b, 2^(b+1))
+};
+
+/**
+ * Read the cycle counter (rdtsc); falls back to CLOCK_MONOTONIC
+ * nanoseconds on non-x86 builds
+ */
+static inline uint64_t hotpath_cycles(void)
+{
+#if defined(__x86_64__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Register one histogram in the process-wide stats registry
+ * Call once per probe point at startup (or lazily before first use).
+ * @param h Histogram with static storage duration
+ * @param name Probe point name reported in snapshots and USDT args
+ * @return 0 on success, -1 when the registry is full
+ */
+int hotpath_register(struct hotpath_hist *h, const char *name);
+
+/**
+ * Record one sample: the cycles elapsed since start
+ * Fires the kernelsight:hotpath_sample USDT probe (name, delta_cycles)
+ * when built with SDT support.
+ * @param h Registered histogram
+ * @param start_cycles hotpath_cycles() taken at section entry
+ */
+void hotpath_record(struct hotpath_hist *h, uint64_t start_cycles);
+
+/**
+ * Serve JSON snapshots of all registered histograms on a Unix socket
+ * Starts a background thread; each accepted connection receives one
+ * snapshot (counts, avg/p50/p99/max in microseconds) and is closed.
+ * @param path Socket path; an existing socket file is replaced
+ * @return 0 on success, -1 on socket or thread failure
+ */
+int hotpath_stats_listen(const char *path);
+
+/**
+ * Stop the stats thread and remove the socket file
+ */
+void hotpath_stats_close(void);
+
+#endif // KERNELSIGHT_HOTPATH_H
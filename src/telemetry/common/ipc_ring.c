@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Shared-memory SPSC ring implementation
+
+#include "ipc_ring.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Frames are 8-byte aligned so a frame header never splits across the
+// wrap point and the pad frame always fits
+#define IPC_RING_ALIGN 8
+
+static uint64_t round_up_pow2(uint64_t v)
+{
+    uint64_t p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+int ipc_ring_create(struct ipc_ring *r, const char *path, uint64_t size)
+{
+    if (!r) {
+        return -1;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    if (size == 0) {
+        size = IPC_RING_DEFAULT_SIZE;
+    }
+    size = round_up_pow2(size);
+
+    r->map_len = sizeof(struct ipc_ring_hdr) + size;
+
+    if (path) {
+        r->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (r->fd < 0) {
+            fprintf(stderr, "ERROR: failed to create IPC ring %s\n", path);
+            return -1;
+        }
+
+        if (ftruncate(r->fd, (off_t)r->map_len) != 0) {
+            fprintf(stderr, "ERROR: failed to size IPC ring %s\n", path);
+            goto fail;
+        }
+
+        r->hdr = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+    } else {
+        // NULL path: anonymous process-private ring (thread-to-thread queue)
+        r->hdr = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                      0);
+    }
+    if (r->hdr == MAP_FAILED) {
+        fprintf(stderr, "ERROR: failed to map IPC ring %s\n", path ? path : "(anonymous)");
+        r->hdr = NULL;
+        goto fail;
+    }
+
+    r->data = (uint8_t *)(r->hdr + 1);
+    r->size = size;
+
+    r->hdr->size = size;
+    r->hdr->head = 0;
+    r->hdr->tail = 0;
+    r->hdr->version = IPC_RING_VERSION;
+    // Magic last: a consumer that maps the file mid-create sees it either
+    // uninitialized or fully initialized
+    __atomic_store_n(&r->hdr->magic, IPC_RING_MAGIC, __ATOMIC_RELEASE);
+
+    return 0;
+
+fail:
+    if (r->fd >= 0) {
+        close(r->fd);
+        r->fd = -1;
+    }
+    return -1;
+}
+
+int ipc_ring_open(struct ipc_ring *r, const char *path)
+{
+    struct stat st;
+
+    if (!r || !path) {
+        return -1;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    r->fd = open(path, O_RDWR);
+    if (r->fd < 0) {
+        fprintf(stderr, "ERROR: failed to open IPC ring %s\n", path);
+        return -1;
+    }
+
+    if (fstat(r->fd, &st) != 0 || (size_t)st.st_size <= sizeof(struct ipc_ring_hdr)) {
+        fprintf(stderr, "ERROR: IPC ring %s is truncated\n", path);
+        goto fail;
+    }
+    r->map_len = (size_t)st.st_size;
+
+    r->hdr = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+    if (r->hdr == MAP_FAILED) {
+        fprintf(stderr, "ERROR: failed to map IPC ring %s\n", path);
+        r->hdr = NULL;
+        goto fail;
+    }
+
+    if (__atomic_load_n(&r->hdr->magic, __ATOMIC_ACQUIRE) != IPC_RING_MAGIC ||
+        r->hdr->version != IPC_RING_VERSION) {
+        fprintf(stderr, "ERROR: IPC ring %s has bad magic or version\n", path);
+        munmap(r->hdr, r->map_len);
+        r->hdr = NULL;
+        goto fail;
+    }
+
+    r->data = (uint8_t *)(r->hdr + 1);
+    r->size = r->hdr->size;
+    if (r->size == 0 || (r->size & (r->size - 1)) != 0 ||
+        r->map_len < sizeof(struct ipc_ring_hdr) + r->size) {
+        fprintf(stderr, "ERROR: IPC ring %s has bad geometry\n", path);
+        munmap(r->hdr, r->map_len);
+        r->hdr = NULL;
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+}
+
+// Write one frame (header + payload) at a ring offset known to be contiguous
+static void put_frame(struct ipc_ring *r, uint64_t offset, uint8_t type, const void *payload,
+                      uint32_t len)
+{
+    struct wire_frame_hdr hdr = {
+        .magic = WIRE_MAGIC,
+        .version = WIRE_VERSION,
+        .type = type,
+        .length = len,
+    };
+
+    memcpy(r->data + offset, &hdr, sizeof(hdr));
+    if (payload && len > 0) {
+        memcpy(r->data + offset + sizeof(hdr), payload, len);
+    }
+}
+
+int ipc_ring_write(struct ipc_ring *r, uint8_t type, const void *payload, uint32_t len)
+{
+    if (!r || !r->hdr) {
+        return -1;
+    }
+
+    uint64_t total = sizeof(struct wire_frame_hdr) + len;
+    total = (total + IPC_RING_ALIGN - 1) & ~(uint64_t)(IPC_RING_ALIGN - 1);
+    if (total > r->size / 2) {
+        r->dropped++;
+        return -1; // Oversized record
+    }
+
+    uint64_t head = r->hdr->head; // Producer-owned, plain read
+    uint64_t tail = __atomic_load_n(&r->hdr->tail, __ATOMIC_ACQUIRE);
+    uint64_t offset = head & (r->size - 1);
+    uint64_t to_end = r->size - offset;
+
+    // Records never straddle the wrap point: if this one would, fill the
+    // remainder with a pad frame readers skip, then start at offset 0
+    uint64_t needed = (to_end < total) ? to_end + total : total;
+    if (needed > r->size - (head - tail)) {
+        r->dropped++;
+        return -1; // Full: drop rather than block the event loop
+    }
+
+    if (to_end < total) {
+        put_frame(r, offset, IPC_RING_PAD_TYPE, NULL,
+                  (uint32_t)(to_end - sizeof(struct wire_frame_hdr)));
+        head += to_end;
+        offset = 0;
+    }
+
+    put_frame(r, offset, type, payload, len);
+    __atomic_store_n(&r->hdr->head, head + total, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const void *ipc_ring_next(struct ipc_ring *r, uint8_t *type, uint32_t *len)
+{
+    if (!r || !r->hdr || !type || !len) {
+        return NULL;
+    }
+
+    for (;;) {
+        uint64_t tail = r->hdr->tail; // Consumer-owned, plain read
+        uint64_t head = __atomic_load_n(&r->hdr->head, __ATOMIC_ACQUIRE);
+        if (tail == head) {
+            return NULL; // Empty
+        }
+
+        uint64_t offset = tail & (r->size - 1);
+        const struct wire_frame_hdr *hdr = (const struct wire_frame_hdr *)(r->data + offset);
+        if (hdr->magic != WIRE_MAGIC) {
+            // Corrupt frame: resynchronize by discarding everything
+            __atomic_store_n(&r->hdr->tail, head, __ATOMIC_RELEASE);
+            return NULL;
+        }
+
+        if (hdr->type == IPC_RING_PAD_TYPE) {
+            uint64_t pad = sizeof(*hdr) + hdr->length;
+            __atomic_store_n(&r->hdr->tail, tail + pad, __ATOMIC_RELEASE);
+            continue; // Wrap-around padding, skip
+        }
+
+        *type = hdr->type;
+        *len = hdr->length;
+        return r->data + offset + sizeof(*hdr);
+    }
+}
+
+void ipc_ring_advance(struct ipc_ring *r)
+{
+    if (!r || !r->hdr) {
+        return;
+    }
+
+    uint64_t tail = r->hdr->tail;
+    uint64_t offset = tail & (r->size - 1);
+    const struct wire_frame_hdr *hdr = (const struct wire_frame_hdr *)(r->data + offset);
+    uint64_t total = sizeof(*hdr) + hdr->length;
+    total = (total + IPC_RING_ALIGN - 1) & ~(uint64_t)(IPC_RING_ALIGN - 1);
+    __atomic_store_n(&r->hdr->tail, tail + total, __ATOMIC_RELEASE);
+}
+
+void ipc_ring_close(struct ipc_ring *r)
+{
+    if (!r) {
+        return;
+    }
+
+    if (r->hdr) {
+        munmap(r->hdr, r->map_len);
+        r->hdr = NULL;
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+        r->fd = -1;
+    }
+}
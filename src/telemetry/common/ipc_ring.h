@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Shared-memory SPSC ring transport between tracers and the ingestion side
+//
+// A file-backed mmap segment holding a single-producer single-consumer
+// ring of wire frames (the same header layout wire.h uses on the binary
+// stdout stream, so consumers share one frame parser). The producer
+// copies each event straight from handle_event() into the mapped data
+// area; the consumer maps the same file and reads frames in place, with
+// no pipe, no re-serialization, and no per-event syscalls on either side.
+//
+// The stdout path remains the portable default; this transport is opt-in
+// for hosts where the pipe is the throughput ceiling.
+//
+// Passing a NULL path to ipc_ring_create() maps the segment anonymously
+// instead, yielding a process-private SPSC queue with the same frame
+// format and memory ordering - the loaders use this to hand events from
+// the ring buffer consumer thread to the serializer thread.
+
+#ifndef KERNELSIGHT_IPC_RING_H
+#define KERNELSIGHT_IPC_RING_H
+
+#include "wire.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IPC_RING_MAGIC 0x4B534950 // "KSIP"
+#define IPC_RING_VERSION 1
+
+// Frame type used to pad out the end of the data area so records never
+// straddle the wrap point; readers skip these
+#define IPC_RING_PAD_TYPE 0
+
+// Default data area size; must be a power of two
+#define IPC_RING_DEFAULT_SIZE (4 * 1024 * 1024)
+
+// Segment header at the start of the mapped file. head and tail are
+// monotonically increasing byte counters on separate cache lines; the
+// producer owns head, the consumer owns tail.
+struct ipc_ring_hdr {
+    uint32_t magic;   // IPC_RING_MAGIC
+    uint32_t version; // IPC_RING_VERSION
+    uint64_t size;    // Data area capacity in bytes (power of two)
+    uint8_t pad0[48];
+    volatile uint64_t head; // Producer position (bytes written)
+    uint8_t pad1[56];
+    volatile uint64_t tail; // Consumer position (bytes consumed)
+    uint8_t pad2[56];
+};
+
+// One mapped ring endpoint (producer or consumer side)
+struct ipc_ring {
+    struct ipc_ring_hdr *hdr; // Mapped segment header
+    uint8_t *data;            // Mapped data area (hdr + 1)
+    uint64_t size;            // Data area capacity
+    size_t map_len;           // Total mapping length
+    int fd;                   // Backing file descriptor
+    uint64_t dropped;         // Producer: records dropped to a full ring
+};
+
+/**
+ * Create (or truncate) a ring segment file and map it as the producer
+ * @param r Ring to initialize
+ * @param path Segment file path (e.g., /dev/shm/kernelsight_syscall.ring),
+ *             or NULL for an anonymous process-private ring
+ * @param size Data area size in bytes, rounded up to a power of two
+ *             (0 for IPC_RING_DEFAULT_SIZE)
+ * @return 0 on success, -1 on error
+ */
+int ipc_ring_create(struct ipc_ring *r, const char *path, uint64_t size);
+
+/**
+ * Map an existing ring segment as the consumer
+ * @param r Ring to initialize
+ * @param path Segment file created by a producer
+ * @return 0 on success, -1 on error (missing file, bad magic/version)
+ */
+int ipc_ring_open(struct ipc_ring *r, const char *path);
+
+/**
+ * Append one record to the ring (producer side)
+ * The payload is copied once, directly into the mapped data area. A full
+ * ring drops the record and counts it in r->dropped rather than blocking
+ * the event loop.
+ * @param r Producer ring
+ * @param type Record type (enum wire_record_type)
+ * @param payload Record payload
+ * @param len Payload length in bytes
+ * @return 0 on success, -1 if the ring is full
+ */
+int ipc_ring_write(struct ipc_ring *r, uint8_t type, const void *payload, uint32_t len);
+
+/**
+ * Peek the next record in place (consumer side)
+ * The returned pointer is valid until ipc_ring_advance(); no copy is made.
+ * @param r Consumer ring
+ * @param type Output record type
+ * @param len Output payload length in bytes
+ * @return Pointer to the payload, or NULL when the ring is empty
+ */
+const void *ipc_ring_next(struct ipc_ring *r, uint8_t *type, uint32_t *len);
+
+/**
+ * Release the record returned by ipc_ring_next() (consumer side)
+ * @param r Consumer ring
+ */
+void ipc_ring_advance(struct ipc_ring *r);
+
+/**
+ * Unmap the segment and close the backing file
+ * @param r Ring to tear down
+ */
+void ipc_ring_close(struct ipc_ring *r);
+
+#endif // KERNELSIGHT_IPC_RING_H
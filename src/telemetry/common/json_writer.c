@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Allocation-free JSON serializer implementation
+
+#include "json_writer.h"
+#include <string.h>
+
+static const char HEX[] = "0123456789abcdef";
+
+// Powers of ten for fixed-precision doubles (precision 0..9)
+static const uint64_t POW10[] = {1,      10,      100,      1000,      10000,
+                                 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static void put_raw(struct json_writer *w, const char *s, size_t n)
+{
+    if (w->overflow || w->len + n >= w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+static void put_char(struct json_writer *w, char c)
+{
+    if (w->overflow || w->len + 1 >= w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    w->buf[w->len++] = c;
+}
+
+// Emit digits by filling a small buffer backwards; one divide per digit
+// and no format-string interpretation
+static void put_u64(struct json_writer *w, uint64_t val)
+{
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+
+    do {
+        *--p = (char)('0' + (val % 10));
+        val /= 10;
+    } while (val);
+
+    put_raw(w, p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+// Write the separating comma (if needed) and the quoted key
+static void put_key(struct json_writer *w, const char *key)
+{
+    if (w->need_comma) {
+        put_char(w, ',');
+    }
+    put_char(w, '"');
+    put_raw(w, key, strlen(key));
+    put_raw(w, "\":", 2);
+    w->need_comma = 1;
+}
+
+void json_writer_init(struct json_writer *w, char *buf, size_t cap)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->depth = 0;
+    w->need_comma = 0;
+    w->overflow = (cap == 0);
+}
+
+void json_obj_begin(struct json_writer *w, const char *key)
+{
+    if (key) {
+        put_key(w, key);
+    } else if (w->need_comma) {
+        put_char(w, ',');
+    }
+    put_char(w, '{');
+    w->depth++;
+    w->need_comma = 0;
+}
+
+void json_obj_end(struct json_writer *w)
+{
+    put_char(w, '}');
+    w->depth--;
+    w->need_comma = 1;
+}
+
+void json_u64(struct json_writer *w, const char *key, uint64_t val)
+{
+    put_key(w, key);
+    put_u64(w, val);
+}
+
+void json_i64(struct json_writer *w, const char *key, int64_t val)
+{
+    put_key(w, key);
+    if (val < 0) {
+        put_char(w, '-');
+        // Negate in unsigned space so INT64_MIN does not overflow
+        put_u64(w, ~(uint64_t)val + 1);
+    } else {
+        put_u64(w, (uint64_t)val);
+    }
+}
+
+void json_double(struct json_writer *w, const char *key, double val, int precision)
+{
+    put_key(w, key);
+
+    if (val != val || val > 1.8e18 || val < -1.8e18) {
+        put_raw(w, "0", 1); // NaN/inf/out of range: emit 0 to keep valid JSON
+        return;
+    }
+
+    if (val < 0) {
+        put_char(w, '-');
+        val = -val;
+    }
+    if (precision < 0) {
+        precision = 0;
+    } else if (precision > 9) {
+        precision = 9;
+    }
+
+    uint64_t scale = POW10[precision];
+    // Round half up at the requested precision, then split into integer
+    // and fractional digits
+    uint64_t scaled = (uint64_t)(val * (double)scale + 0.5);
+    uint64_t whole = scaled / scale;
+    uint64_t frac = scaled % scale;
+
+    put_u64(w, whole);
+    if (precision > 0) {
+        char tmp[12];
+        put_char(w, '.');
+        for (int i = precision - 1; i >= 0; i--) {
+            tmp[i] = (char)('0' + (frac % 10));
+            frac /= 10;
+        }
+        put_raw(w, tmp, (size_t)precision);
+    }
+}
+
+void json_str(struct json_writer *w, const char *key, const char *val)
+{
+    put_key(w, key);
+    put_char(w, '"');
+
+    for (const unsigned char *p = (const unsigned char *)val; *p; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            put_char(w, '\\');
+            put_char(w, (char)c);
+        } else if (c >= 0x20) {
+            put_char(w, (char)c);
+        } else {
+            // Control character: \uXXXX keeps the record parseable
+            char esc[6] = {'\\', 'u', '0', '0', HEX[(c >> 4) & 0xF], HEX[c & 0xF]};
+            put_raw(w, esc, sizeof(esc));
+        }
+    }
+
+    put_char(w, '"');
+}
+
+void json_hex(struct json_writer *w, const char *key, uint64_t val)
+{
+    char tmp[16];
+    char *p = tmp + sizeof(tmp);
+
+    do {
+        *--p = HEX[val & 0xF];
+        val >>= 4;
+    } while (val);
+
+    put_key(w, key);
+    put_raw(w, "\"0x", 3);
+    put_raw(w, p, (size_t)(tmp + sizeof(tmp) - p));
+    put_char(w, '"');
+}
+
+void json_bool(struct json_writer *w, const char *key, int val)
+{
+    put_key(w, key);
+    if (val) {
+        put_raw(w, "true", 4);
+    } else {
+        put_raw(w, "false", 5);
+    }
+}
+
+int json_writer_finish(struct json_writer *w)
+{
+    if (w->overflow || w->depth != 0) {
+        return -1;
+    }
+    w->buf[w->len] = '\0';
+    return (int)w->len;
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Allocation-free JSON serializer for the hot emit paths
+//
+// printf format-string interpretation is a measurable fraction of loader
+// CPU at high event rates. This writer appends fields into a
+// caller-provided buffer with branch-light integer-to-ASCII conversion,
+// fixed-precision double formatting, and proper string escaping (a comm
+// containing a quote or control character no longer produces invalid
+// JSON). Commas are inserted automatically between fields.
+
+#ifndef KERNELSIGHT_JSON_WRITER_H
+#define KERNELSIGHT_JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Serializer state over a caller-provided buffer. Overflow is sticky:
+// once a field does not fit, json_writer_finish() reports failure and
+// the caller drops the record, so no partial JSON is ever emitted.
+struct json_writer {
+    char *buf;     // Caller-provided output buffer
+    size_t cap;    // Buffer capacity
+    size_t len;    // Bytes written so far
+    int depth;     // Open object count (for comma placement)
+    int need_comma; // Next field must be preceded by a comma
+    int overflow;  // Sticky out-of-space flag
+};
+
+/**
+ * Start serializing into a caller-provided buffer
+ * @param w Writer state
+ * @param buf Output buffer
+ * @param cap Buffer capacity in bytes
+ */
+void json_writer_init(struct json_writer *w, char *buf, size_t cap);
+
+/**
+ * Open the top-level object or a nested object under a key
+ * @param w Writer
+ * @param key Field name, or NULL for the top-level object
+ */
+void json_obj_begin(struct json_writer *w, const char *key);
+
+/**
+ * Close the innermost open object
+ * @param w Writer
+ */
+void json_obj_end(struct json_writer *w);
+
+/**
+ * Append an unsigned integer field
+ * @param w Writer
+ * @param key Field name
+ * @param val Value
+ */
+void json_u64(struct json_writer *w, const char *key, uint64_t val);
+
+/**
+ * Append a signed integer field
+ * @param w Writer
+ * @param key Field name
+ * @param val Value
+ */
+void json_i64(struct json_writer *w, const char *key, int64_t val);
+
+/**
+ * Append a fixed-precision double field (no exponent form)
+ * @param w Writer
+ * @param key Field name
+ * @param val Value
+ * @param precision Digits after the decimal point (0..9)
+ */
+void json_double(struct json_writer *w, const char *key, double val, int precision);
+
+/**
+ * Append an escaped string field
+ * Quotes, backslashes and control characters are escaped, so untrusted
+ * process names cannot break the record.
+ * @param w Writer
+ * @param key Field name
+ * @param val NUL-terminated value
+ */
+void json_str(struct json_writer *w, const char *key, const char *val);
+
+/**
+ * Append an address field formatted as a "0x..." hex string
+ * @param w Writer
+ * @param key Field name
+ * @param val Value
+ */
+void json_hex(struct json_writer *w, const char *key, uint64_t val);
+
+/**
+ * Append a boolean field (emitted as true/false)
+ * @param w Writer
+ * @param key Field name
+ * @param val Zero for false, nonzero for true
+ */
+void json_bool(struct json_writer *w, const char *key, int val);
+
+/**
+ * Finish the record and NUL-terminate the buffer
+ * @param w Writer
+ * @return Record length in bytes, or -1 if the buffer overflowed
+ */
+int json_writer_finish(struct json_writer *w);
+
+#endif // KERNELSIGHT_JSON_WRITER_H
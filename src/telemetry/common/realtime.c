@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Realtime runtime mode: memory locking, stack prefaulting, CPU
+// affinity and optional SCHED_FIFO elevation for the collectors
+
+#define _GNU_SOURCE // sched_setaffinity(), CPU_SET
+
+#include "realtime.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Stack headroom to fault in up front; deeper than any call path in the
+// loaders, so stack growth never takes a first-touch fault later
+#define PREFAULT_STACK_BYTES (256 * 1024)
+
+// Touch one byte per page of a freshly grown stack region. mlockall()
+// locks pages as they are faulted in, so after this walk the whole
+// region is resident and locked.
+static void prefault_stack(void)
+{
+    volatile unsigned char probe[PREFAULT_STACK_BYTES];
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0; i < sizeof(probe); i += page) {
+        probe[i] = 0;
+    }
+    probe[sizeof(probe) - 1] = 0;
+}
+
+int realtime_enter(int cpu, int fifo_priority)
+{
+    // Lock everything mapped now and everything mapped later (ring
+    // buffer mmaps, spool segments, the wire output buffer) into RAM
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr,
+                "ERROR: mlockall failed: %s (requires CAP_IPC_LOCK or a raised RLIMIT_MEMLOCK)\n",
+                strerror(errno));
+        return -1;
+    }
+
+    prefault_stack();
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((unsigned int)cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "ERROR: cannot pin to CPU %d: %s\n", cpu, strerror(errno));
+            return -1;
+        }
+    }
+
+    if (fifo_priority > 0) {
+        struct sched_param sp = {.sched_priority = fifo_priority};
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
+            // FIFO is an optional elevation: an unprivileged host still
+            // benefits from the locking and pinning above
+            fprintf(stderr,
+                    "WARNING: SCHED_FIFO priority %d unavailable: %s; continuing at normal priority\n",
+                    fifo_priority, strerror(errno));
+        }
+    }
+
+    return 0;
+}
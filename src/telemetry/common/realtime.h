@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Realtime runtime mode shared by the tracer loaders and the scraper
+// daemon. The collectors exist to observe CPU contention and memory
+// pressure, so they must not be starved or paged out by the very
+// conditions they report on: telemetry should degrade last, not first.
+
+#ifndef KERNELSIGHT_REALTIME_H
+#define KERNELSIGHT_REALTIME_H
+
+/**
+ * Lock and pin the calling process for observation under pressure:
+ * mlockall() current and future mappings (so the output buffers, ring
+ * mappings and spool segments can never be paged out), prefault the
+ * stack, optionally pin to a housekeeping core and elevate to
+ * SCHED_FIFO.
+ *
+ * @param cpu CPU to pin to, or -1 to leave affinity unchanged
+ * @param fifo_priority SCHED_FIFO priority (1-99), or 0 to stay at
+ *                      normal scheduling; an unprivileged failure to
+ *                      elevate warns and continues
+ * @return 0 on success, -1 if locking or pinning failed
+ */
+int realtime_enter(int cpu, int fifo_priority);
+
+#endif // KERNELSIGHT_REALTIME_H
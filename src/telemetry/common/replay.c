@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Replay engine implementation
+// See replay.h for the capture format and pacing semantics.
+
+#include "replay.h"
+#include "wire.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double rusage_cpu_sec(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+           (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+// Read the whole capture into memory; replayed streams are bounded by
+// what staging can hold anyway, and a single buffer keeps the frame
+// walk branch-free
+static uint8_t *read_file(const char *path, size_t *len_out)
+{
+    struct stat st;
+    uint8_t *buf;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "ERROR: cannot open capture '%s': %s\n", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    buf = malloc(st.st_size > 0 ? (size_t)st.st_size : 1);
+    if (!buf) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t off = 0;
+    while (off < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + off, (size_t)st.st_size - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "ERROR: cannot read capture '%s': %s\n", path, strerror(errno));
+            free(buf);
+            close(fd);
+            return NULL;
+        }
+        if (n == 0) {
+            break;
+        }
+        off += (size_t)n;
+    }
+
+    close(fd);
+    *len_out = off;
+    return buf;
+}
+
+// Decode a .zst capture frame by frame into one buffer. The writer ends
+// every flush with a complete frame, so the walk below is also a cheap
+// integrity check on the capture.
+static uint8_t *decompress_zstd(const uint8_t *zdata, size_t zlen, size_t *len_out)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    uint8_t *out = NULL;
+    size_t out_len = 0;
+    size_t out_cap = 0;
+    size_t off = 0;
+
+    if (!dctx) {
+        return NULL;
+    }
+
+    while (off < zlen) {
+        size_t frame_size = ZSTD_findFrameCompressedSize(zdata + off, zlen - off);
+        if (ZSTD_isError(frame_size)) {
+            fprintf(stderr, "ERROR: corrupt zstd frame at offset %zu: %s\n", off,
+                    ZSTD_getErrorName(frame_size));
+            goto fail;
+        }
+
+        unsigned long long content = ZSTD_getFrameContentSize(zdata + off, frame_size);
+        if (content == ZSTD_CONTENTSIZE_ERROR || content == ZSTD_CONTENTSIZE_UNKNOWN) {
+            fprintf(stderr, "ERROR: zstd frame at offset %zu has no content size\n", off);
+            goto fail;
+        }
+
+        if (out_len + content > out_cap) {
+            size_t new_cap = out_cap ? out_cap * 2 : 1024 * 1024;
+            while (new_cap < out_len + content) {
+                new_cap *= 2;
+            }
+            uint8_t *grown = realloc(out, new_cap);
+            if (!grown) {
+                goto fail;
+            }
+            out = grown;
+            out_cap = new_cap;
+        }
+
+        size_t d = ZSTD_decompressDCtx(dctx, out + out_len, out_cap - out_len, zdata + off,
+                                       frame_size);
+        if (ZSTD_isError(d)) {
+            fprintf(stderr, "ERROR: zstd decode failed at offset %zu: %s\n", off,
+                    ZSTD_getErrorName(d));
+            goto fail;
+        }
+
+        out_len += d;
+        off += frame_size;
+    }
+
+    ZSTD_freeDCtx(dctx);
+    *len_out = out_len;
+    return out;
+
+fail:
+    ZSTD_freeDCtx(dctx);
+    free(out);
+    return NULL;
+#else
+    (void)zdata;
+    (void)zlen;
+    (void)len_out;
+    fprintf(stderr, "ERROR: built without zstd support (install libzstd-dev and rebuild)\n");
+    return NULL;
+#endif
+}
+
+static int has_suffix(const char *s, const char *suffix)
+{
+    size_t sl = strlen(s);
+    size_t xl = strlen(suffix);
+    return sl >= xl && strcmp(s + sl - xl, suffix) == 0;
+}
+
+int replay_run(const char *path, int timed, replay_record_ns_fn record_ns,
+               replay_dispatch_fn dispatch, struct replay_stats *st)
+{
+    uint8_t *data;
+    size_t len;
+
+    if (!path || !dispatch || !st) {
+        return -1;
+    }
+    memset(st, 0, sizeof(*st));
+
+    data = read_file(path, &len);
+    if (!data) {
+        return -1;
+    }
+
+    if (has_suffix(path, ".zst")) {
+        size_t raw_len;
+        uint8_t *raw = decompress_zstd(data, len, &raw_len);
+        free(data);
+        if (!raw) {
+            return -1;
+        }
+        data = raw;
+        len = raw_len;
+    }
+
+    uint64_t start_wall = monotonic_ns();
+    double start_cpu = rusage_cpu_sec();
+    uint64_t first_rec_ns = 0;
+    size_t off = 0;
+
+    while (off + sizeof(struct wire_frame_hdr) <= len) {
+        const struct wire_frame_hdr *hdr = (const struct wire_frame_hdr *)(data + off);
+
+        if (hdr->magic != WIRE_MAGIC || hdr->version != WIRE_VERSION) {
+            fprintf(stderr, "ERROR: bad frame header at offset %zu in '%s'\n", off, path);
+            free(data);
+            return -1;
+        }
+        if (off + sizeof(*hdr) + hdr->length > len) {
+            fprintf(stderr, "ERROR: truncated frame at offset %zu in '%s'\n", off, path);
+            free(data);
+            return -1;
+        }
+
+        const void *payload = data + off + sizeof(*hdr);
+
+        // Timed mode: hold each record until its offset from the first
+        // record's timestamp has elapsed on the wall clock
+        if (timed && record_ns) {
+            uint64_t rec_ns = record_ns(hdr->type, payload, hdr->length);
+            if (rec_ns > 0) {
+                if (first_rec_ns == 0) {
+                    first_rec_ns = rec_ns;
+                } else if (rec_ns > first_rec_ns) {
+                    uint64_t target = start_wall + (rec_ns - first_rec_ns);
+                    uint64_t now = monotonic_ns();
+                    if (target > now) {
+                        struct timespec ts = {
+                            .tv_sec = (time_t)((target - now) / 1000000000ULL),
+                            .tv_nsec = (long)((target - now) % 1000000000ULL),
+                        };
+                        nanosleep(&ts, NULL);
+                    }
+                }
+            }
+        }
+
+        if (dispatch(hdr->type, payload, hdr->length)) {
+            st->records++;
+        } else {
+            st->skipped++;
+        }
+
+        off += sizeof(*hdr) + hdr->length;
+    }
+
+    if (off != len) {
+        fprintf(stderr, "WARNING: %zu trailing bytes ignored in '%s'\n", len - off, path);
+    }
+
+    st->bytes = len;
+    st->wall_sec = (double)(monotonic_ns() - start_wall) / 1e9;
+    st->cpu_sec = rusage_cpu_sec() - start_cpu;
+
+    free(data);
+    return 0;
+}
+
+void replay_report(const char *source, const struct replay_stats *st)
+{
+    double rate = st->wall_sec > 0 ? (double)st->records / st->wall_sec : 0;
+    double cpu_pct = st->wall_sec > 0 ? 100.0 * st->cpu_sec / st->wall_sec : 0;
+
+    fprintf(stderr,
+            "Replay of %s: %llu records (%llu skipped, %.1f MB) in %.3fs wall, "
+            "%.3fs CPU (%.1f%%), %.0f events/sec\n",
+            source, (unsigned long long)st->records, (unsigned long long)st->skipped,
+            (double)st->bytes / (1024.0 * 1024.0), st->wall_sec, st->cpu_sec, cpu_pct, rate);
+}
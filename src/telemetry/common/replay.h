@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Replay engine for recorded binary event streams (--replay)
+//
+// Reads a capture of the loader's own wire frames — optionally
+// zstd-compressed — and dispatches each record back through the loader's
+// live event-handling path, either at the recorded timing or at max
+// speed. This reproduces production workloads in staging and CI without
+// root or BPF privileges, and benchmarks the userspace pipeline against
+// real event streams.
+
+#ifndef KERNELSIGHT_REPLAY_H
+#define KERNELSIGHT_REPLAY_H
+
+#include <stdint.h>
+
+// Throughput accounting filled in by replay_run()
+struct replay_stats {
+    uint64_t records; // Records dispatched through the pipeline
+    uint64_t skipped; // Frames of record types the loader does not replay
+    uint64_t bytes;   // Uncompressed stream bytes walked
+    double wall_sec;  // Wall-clock replay duration
+    double cpu_sec;   // Process CPU time consumed (user + system)
+};
+
+/**
+ * Dispatch one record into the loader's pipeline
+ * @return 1 if the record was consumed, 0 if the type is not replayed
+ */
+typedef int (*replay_dispatch_fn)(uint8_t type, const void *payload, uint32_t len);
+
+/**
+ * Extract the recorded timestamp of one record for timed pacing
+ * @return Nanosecond timestamp, or 0 when the record carries none
+ */
+typedef uint64_t (*replay_record_ns_fn)(uint8_t type, const void *payload, uint32_t len);
+
+/**
+ * Replay a recorded stream through the dispatch callback
+ * A path ending in .zst is decompressed first (requires a zstd build).
+ * @param path Capture file of wire frames
+ * @param timed Nonzero to pace records by their recorded timestamps;
+ *              zero replays at max speed
+ * @param record_ns Timestamp extractor (used only when timed)
+ * @param dispatch Record sink; called in stream order
+ * @param st Filled with throughput accounting
+ * @return 0 on success, -1 on a read, decode or framing error
+ */
+int replay_run(const char *path, int timed, replay_record_ns_fn record_ns,
+               replay_dispatch_fn dispatch, struct replay_stats *st);
+
+/**
+ * Print the events/sec and CPU-time report to stderr
+ * @param source Capture path, echoed in the report
+ * @param st Accounting from replay_run()
+ */
+void replay_report(const char *source, const struct replay_stats *st);
+
+#endif // KERNELSIGHT_REPLAY_H
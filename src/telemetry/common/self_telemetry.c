@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Tracer self-telemetry implementation
+
+#include "self_telemetry.h"
+#include "json_writer.h"
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Map the ring buffer's consumer and producer position pages so utilization
+// can be sampled without draining the ring. Layout matches the kernel ABI:
+// consumer page at offset 0 (read-write), producer page at one page (read-only).
+static void map_ring_positions(struct self_telemetry *st, int ringbuf_map_fd)
+{
+    struct bpf_map_info info = {};
+    unsigned int info_len = sizeof(info);
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *consumer, *producer;
+
+    if (bpf_obj_get_info_by_fd(ringbuf_map_fd, &info, &info_len) != 0) {
+        return;
+    }
+
+    consumer = mmap(NULL, page_size, PROT_READ, MAP_SHARED, ringbuf_map_fd, 0);
+    if (consumer == MAP_FAILED) {
+        return;
+    }
+
+    producer = mmap(NULL, page_size, PROT_READ, MAP_SHARED, ringbuf_map_fd, page_size);
+    if (producer == MAP_FAILED) {
+        munmap(consumer, page_size);
+        return;
+    }
+
+    st->ring_size = info.max_entries;
+    st->ring_consumer = (volatile uint64_t *)consumer;
+    st->ring_producer = (volatile uint64_t *)producer;
+    st->ring_mmap_len = page_size;
+}
+
+void self_telemetry_init(struct self_telemetry *st, const char *tracer, int stats_map_fd,
+                         int ringbuf_map_fd)
+{
+    memset(st, 0, sizeof(*st));
+    st->tracer = tracer;
+    st->stats_map_fd = stats_map_fd;
+
+    if (ringbuf_map_fd >= 0) {
+        map_ring_positions(st, ringbuf_map_fd);
+    }
+
+    st->next_emit_ns = monotonic_ns() + SELF_TELEMETRY_INTERVAL_SEC * 1000000000ULL;
+}
+
+// Merge the per-CPU kernel counters into a single total
+static void read_prog_stats(int stats_map_fd, struct prog_stats *total)
+{
+    unsigned int nr_cpus = libbpf_num_possible_cpus();
+    struct prog_stats *cpu_stats;
+    unsigned int key = 0;
+
+    memset(total, 0, sizeof(*total));
+
+    cpu_stats = calloc(nr_cpus, sizeof(struct prog_stats));
+    if (!cpu_stats) {
+        return;
+    }
+
+    if (bpf_map_lookup_elem(stats_map_fd, &key, cpu_stats) == 0) {
+        for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+            total->events_submitted += cpu_stats[cpu].events_submitted;
+            total->ringbuf_drops += cpu_stats[cpu].ringbuf_drops;
+        }
+    }
+
+    free(cpu_stats);
+}
+
+void self_telemetry_maybe_emit(struct self_telemetry *st, struct wire_writer *w)
+{
+    struct prog_stats kernel_stats = {0, 0};
+    struct rusage usage;
+    uint64_t ring_used = 0;
+    double cpu_time_sec = 0.0;
+    uint64_t now = monotonic_ns();
+
+    if (now < st->next_emit_ns) {
+        return;
+    }
+    st->next_emit_ns = now + SELF_TELEMETRY_INTERVAL_SEC * 1000000000ULL;
+
+    if (st->stats_map_fd >= 0) {
+        read_prog_stats(st->stats_map_fd, &kernel_stats);
+    }
+
+    // Unconsumed bytes: distance between the kernel's producer position and
+    // the (possibly lagging) consumer position
+    if (st->ring_producer && st->ring_consumer) {
+        uint64_t prod = *st->ring_producer;
+        uint64_t cons = *st->ring_consumer;
+        if (prod > cons) {
+            ring_used = prod - cons;
+        }
+    }
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        cpu_time_sec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    uint64_t timestamp = time(NULL) * 1000000000ULL;
+
+    // Binary mode: emit one fixed-layout record
+    if (w->format == WIRE_FORMAT_BINARY) {
+        struct self_telemetry_record rec = {
+            .timestamp = timestamp,
+            .events_consumed = st->events_consumed,
+            .events_submitted = kernel_stats.events_submitted,
+            .ringbuf_drops = kernel_stats.ringbuf_drops,
+            .ring_size_bytes = st->ring_size,
+            .ring_used_bytes = ring_used,
+            .cpu_time_sec = cpu_time_sec,
+        };
+        snprintf(rec.tracer, sizeof(rec.tracer), "%s", st->tracer);
+        wire_write_record(w, WIRE_REC_SELF, &rec, sizeof(rec));
+        return;
+    }
+
+    double ring_utilization = 0.0;
+    if (st->ring_size > 0) {
+        ring_utilization = (double)ring_used / (double)st->ring_size;
+    }
+
+    char line[512];
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "tracer", st->tracer);
+    json_u64(&jw, "events_consumed", st->events_consumed);
+    json_u64(&jw, "events_submitted", kernel_stats.events_submitted);
+    json_u64(&jw, "ringbuf_drops", kernel_stats.ringbuf_drops);
+    json_u64(&jw, "ring_size_bytes", st->ring_size);
+    json_u64(&jw, "ring_used_bytes", ring_used);
+    json_double(&jw, "ring_utilization", ring_utilization, 4);
+    json_double(&jw, "cpu_time_sec", cpu_time_sec, 3);
+    json_str(&jw, "type", "self_telemetry");
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(w, line, len);
+    }
+}
+
+void self_telemetry_destroy(struct self_telemetry *st)
+{
+    if (st->ring_consumer) {
+        munmap((void *)st->ring_consumer, st->ring_mmap_len);
+        st->ring_consumer = NULL;
+    }
+    if (st->ring_producer) {
+        munmap((void *)st->ring_producer, st->ring_mmap_len);
+        st->ring_producer = NULL;
+    }
+}
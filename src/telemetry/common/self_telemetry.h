@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Tracer self-telemetry: ring buffer drop accounting and loader health.
+// Each BPF program counts ringbuf reserve failures in a per-CPU stats map;
+// the loader merges those counters and periodically emits one record
+// (drops, events consumed, ring utilization, loader CPU time) on the same
+// output stream as the data it collects. This is how we detect backpressure
+// and size ring buffers instead of silently losing events.
+
+#ifndef KERNELSIGHT_SELF_TELEMETRY_H
+#define KERNELSIGHT_SELF_TELEMETRY_H
+
+#include "wire.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// How often self-telemetry records are emitted (seconds)
+#define SELF_TELEMETRY_INTERVAL_SEC 10
+
+// Per-CPU counters maintained by the BPF programs (must match BPF side)
+struct prog_stats {
+    uint64_t events_submitted; // Successful bpf_ringbuf_submit() calls
+    uint64_t ringbuf_drops;    // Failed bpf_ringbuf_reserve() calls
+};
+
+// Binary wire record for one self-telemetry interval (WIRE_REC_SELF payload)
+struct self_telemetry_record {
+    uint64_t timestamp;        // Emission time (nanoseconds since epoch)
+    uint64_t events_consumed;  // Events handled by the loader (cumulative)
+    uint64_t events_submitted; // Events submitted kernel-side (cumulative)
+    uint64_t ringbuf_drops;    // Reserve failures kernel-side (cumulative)
+    uint64_t ring_size_bytes;  // Ring buffer capacity (0 if no ring)
+    uint64_t ring_used_bytes;  // Unconsumed bytes at sample time
+    double cpu_time_sec;       // Loader user+system CPU time
+    char tracer[16];           // Source tracer name
+};
+
+// One self-telemetry source: a tracer's kernel counters plus its ring buffer
+struct self_telemetry {
+    const char *tracer;       // Name used in emitted records
+    int stats_map_fd;         // Per-CPU prog_stats map (-1 if none)
+    uint64_t ring_size;       // Ring buffer data size in bytes (0 if none)
+    volatile uint64_t *ring_producer; // Mapped producer position (NULL if none)
+    volatile uint64_t *ring_consumer; // Mapped consumer position (NULL if none)
+    size_t ring_mmap_len;     // Length of each position mapping
+    uint64_t events_consumed; // Incremented by the loader per handled event
+    uint64_t next_emit_ns;    // Monotonic deadline for the next record
+};
+
+// Initialize a self-telemetry source. stats_map_fd is the BPF per-CPU stats
+// map (-1 if the program has none); ringbuf_map_fd is the ring buffer map
+// whose utilization should be sampled (-1 if none). Always succeeds; if the
+// ring positions cannot be mapped, utilization is reported as zero.
+void self_telemetry_init(struct self_telemetry *st, const char *tracer, int stats_map_fd,
+                         int ringbuf_map_fd);
+
+// Emit one record if the interval has elapsed. Call from the main loop
+// alongside wire_maybe_flush().
+void self_telemetry_maybe_emit(struct self_telemetry *st, struct wire_writer *w);
+
+// Unmap ring buffer positions
+void self_telemetry_destroy(struct self_telemetry *st);
+
+#endif // KERNELSIGHT_SELF_TELEMETRY_H
@@ -0,0 +1,465 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Store-and-forward mmap spool implementation
+
+#define _GNU_SOURCE // fallocate()
+#include "spool.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Frames are 8-byte aligned, matching ipc_ring, so the published magic
+// store below is always naturally aligned
+#define SPOOL_ALIGN 8
+
+// Build the path of one segment file; zero-padded so lexical order
+// matches sequence order in directory listings
+static void seg_path(const char *dir, uint64_t seq, char *buf, size_t buf_len)
+{
+    snprintf(buf, buf_len, "%s/%012" PRIu64 ".seg", dir, seq);
+}
+
+static void commit_path(const char *dir, char *buf, size_t buf_len)
+{
+    snprintf(buf, buf_len, "%s/commit", dir);
+}
+
+// Read the consumer's persisted position; returns 0 if one exists
+static int read_commit(const char *dir, uint64_t *seq, uint64_t *offset)
+{
+    char path[512];
+    FILE *fp;
+    int ok;
+
+    commit_path(dir, path, sizeof(path));
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    ok = fscanf(fp, "%" SCNu64 " %" SCNu64, seq, offset) == 2;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+// Scan the spool directory for segment files; returns the number found
+// and the lowest/highest sequence numbers present
+static int scan_segments(const char *dir, uint64_t *lowest, uint64_t *highest)
+{
+    DIR *d;
+    struct dirent *entry;
+    int count = 0;
+
+    d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+
+    while ((entry = readdir(d)) != NULL) {
+        uint64_t seq;
+        if (sscanf(entry->d_name, "%" SCNu64 ".seg", &seq) != 1) {
+            continue;
+        }
+        if (count == 0 || seq < *lowest) {
+            *lowest = seq;
+        }
+        if (count == 0 || seq > *highest) {
+            *highest = seq;
+        }
+        count++;
+    }
+
+    closedir(d);
+    return count;
+}
+
+// Create, preallocate, and map one fresh segment for appending
+static int writer_open_segment(struct spool_writer *w)
+{
+    char path[512];
+    struct spool_seg_hdr hdr = {
+        .magic = SPOOL_SEG_MAGIC,
+        .version = SPOOL_SEG_VERSION,
+        .seq = w->seq,
+    };
+
+    seg_path(w->dir, w->seq, path, sizeof(path));
+
+    w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        fprintf(stderr, "ERROR: failed to create spool segment %s\n", path);
+        return -1;
+    }
+
+    // Preallocate the whole segment up front so appends never block on
+    // block allocation; fall back to ftruncate where unsupported
+    if (fallocate(w->fd, 0, 0, (off_t)w->seg_size) != 0) {
+        if (ftruncate(w->fd, (off_t)w->seg_size) != 0) {
+            fprintf(stderr, "ERROR: failed to preallocate spool segment %s\n", path);
+            close(w->fd);
+            w->fd = -1;
+            return -1;
+        }
+    }
+
+    w->map = mmap(NULL, w->seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (w->map == MAP_FAILED) {
+        fprintf(stderr, "ERROR: failed to map spool segment %s\n", path);
+        w->map = NULL;
+        close(w->fd);
+        w->fd = -1;
+        return -1;
+    }
+
+    memcpy(w->map, &hdr, sizeof(hdr));
+    w->offset = sizeof(hdr);
+    return 0;
+}
+
+// Enforce the segment cap: delete the segment falling off the window,
+// counting it as lost data only if the consumer had not reached it yet
+static void writer_recycle(struct spool_writer *w)
+{
+    char path[512];
+    uint64_t committed_seq = 0, committed_off = 0;
+    uint64_t old;
+
+    if (w->seq < w->max_segments) {
+        return;
+    }
+    old = w->seq - w->max_segments;
+
+    seg_path(w->dir, old, path, sizeof(path));
+    if (unlink(path) == 0) {
+        if (read_commit(w->dir, &committed_seq, &committed_off) != 0 || committed_seq <= old) {
+            w->recycled++;
+        }
+    }
+}
+
+int spool_writer_open(struct spool_writer *w, const char *dir, size_t seg_size,
+                      unsigned int max_segments)
+{
+    uint64_t lowest = 0, highest = 0;
+
+    if (!w || !dir) {
+        return -1;
+    }
+
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    snprintf(w->dir, sizeof(w->dir), "%s", dir);
+    w->seg_size = seg_size ? seg_size : SPOOL_DEFAULT_SEG_SIZE;
+    w->max_segments = max_segments ? max_segments : SPOOL_DEFAULT_MAX_SEGMENTS;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "ERROR: failed to create spool directory %s\n", dir);
+        return -1;
+    }
+
+    // Start after the highest existing segment so a restarted producer
+    // never clobbers data the consumer has not drained yet
+    if (scan_segments(dir, &lowest, &highest) > 0) {
+        w->seq = highest + 1;
+    }
+
+    writer_recycle(w);
+    return writer_open_segment(w);
+}
+
+// Write one frame at the current offset, publishing the magic last so a
+// concurrent tailer never sees a partial frame
+static void writer_put_frame(struct spool_writer *w, uint8_t type, const void *payload,
+                             uint32_t len)
+{
+    struct wire_frame_hdr hdr = {
+        .magic = 0, // Published below, after the payload is in place
+        .version = WIRE_VERSION,
+        .type = type,
+        .length = len,
+    };
+
+    memcpy(w->map + w->offset, &hdr, sizeof(hdr));
+    if (payload && len > 0) {
+        memcpy(w->map + w->offset + sizeof(hdr), payload, len);
+    }
+    __atomic_store_n((uint16_t *)(w->map + w->offset), WIRE_MAGIC, __ATOMIC_RELEASE);
+}
+
+// Seal the current segment and move on to the next one
+static int writer_rotate(struct spool_writer *w)
+{
+    writer_put_frame(w, SPOOL_REC_SEAL, NULL, 0);
+
+    munmap(w->map, w->seg_size);
+    w->map = NULL;
+    close(w->fd);
+    w->fd = -1;
+
+    w->seq++;
+    writer_recycle(w);
+    return writer_open_segment(w);
+}
+
+int spool_write_record(struct spool_writer *w, uint8_t type, const void *payload, uint32_t len)
+{
+    if (!w || !w->map) {
+        return -1;
+    }
+
+    size_t total = sizeof(struct wire_frame_hdr) + len;
+    total = (total + SPOOL_ALIGN - 1) & ~(size_t)(SPOOL_ALIGN - 1);
+
+    // Always keep room for the seal frame at the end of the segment
+    size_t usable = w->seg_size - sizeof(struct wire_frame_hdr);
+    if (sizeof(struct spool_seg_hdr) + total > usable) {
+        return -1; // Oversized record
+    }
+
+    if (w->offset + total > usable) {
+        if (writer_rotate(w) != 0) {
+            return -1;
+        }
+    }
+
+    writer_put_frame(w, type, payload, len);
+    w->offset += total;
+    return 0;
+}
+
+void spool_writer_close(struct spool_writer *w)
+{
+    if (!w) {
+        return;
+    }
+
+    if (w->map) {
+        // Seal so a tailer knows this segment is complete even though a
+        // restarted producer will continue in a new one
+        writer_put_frame(w, SPOOL_REC_SEAL, NULL, 0);
+        munmap(w->map, w->seg_size);
+        w->map = NULL;
+    }
+    if (w->fd >= 0) {
+        close(w->fd);
+        w->fd = -1;
+    }
+}
+
+// Map the reader's current segment; returns -1 if it does not exist yet
+static int reader_open_segment(struct spool_reader *r)
+{
+    char path[512];
+    struct stat st;
+    const struct spool_seg_hdr *hdr;
+
+    seg_path(r->dir, r->seq, path, sizeof(path));
+
+    r->fd = open(path, O_RDONLY);
+    if (r->fd < 0) {
+        return -1;
+    }
+
+    if (fstat(r->fd, &st) != 0 || (size_t)st.st_size <= sizeof(struct spool_seg_hdr)) {
+        close(r->fd);
+        r->fd = -1;
+        return -1;
+    }
+    r->seg_size = (size_t)st.st_size;
+
+    r->map = mmap(NULL, r->seg_size, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (r->map == MAP_FAILED) {
+        r->map = NULL;
+        close(r->fd);
+        r->fd = -1;
+        return -1;
+    }
+
+    hdr = (const struct spool_seg_hdr *)r->map;
+    if (hdr->magic != SPOOL_SEG_MAGIC || hdr->version != SPOOL_SEG_VERSION ||
+        hdr->seq != r->seq) {
+        fprintf(stderr, "ERROR: spool segment %s has bad magic or sequence\n", path);
+        munmap(r->map, r->seg_size);
+        r->map = NULL;
+        close(r->fd);
+        r->fd = -1;
+        return -1;
+    }
+
+    if (r->offset < sizeof(*hdr)) {
+        r->offset = sizeof(*hdr);
+    }
+    return 0;
+}
+
+static void reader_close_segment(struct spool_reader *r)
+{
+    if (r->map) {
+        munmap(r->map, r->seg_size);
+        r->map = NULL;
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+        r->fd = -1;
+    }
+}
+
+int spool_reader_open(struct spool_reader *r, const char *dir)
+{
+    uint64_t lowest = 0, highest = 0;
+    uint64_t seq, offset;
+
+    if (!r || !dir) {
+        return -1;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    snprintf(r->dir, sizeof(r->dir), "%s", dir);
+
+    if (scan_segments(dir, &lowest, &highest) == 0) {
+        fprintf(stderr, "ERROR: no spool segments in %s\n", dir);
+        return -1;
+    }
+
+    if (read_commit(dir, &seq, &offset) == 0 && seq >= lowest) {
+        // Resume from the committed position
+        r->seq = seq;
+        r->offset = offset;
+    } else {
+        // No commit state (or it points at a recycled segment): start at
+        // the oldest data still on disk
+        r->seq = lowest;
+        r->offset = 0;
+    }
+
+    if (reader_open_segment(r) != 0) {
+        // Committed segment vanished between scan and open: fall back
+        r->seq = lowest;
+        r->offset = 0;
+        if (reader_open_segment(r) != 0) {
+            fprintf(stderr, "ERROR: failed to open spool segment in %s\n", dir);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Step to the next segment in sequence (which may not exist yet)
+static void reader_next_segment(struct spool_reader *r)
+{
+    reader_close_segment(r);
+    r->seq++;
+    r->offset = 0;
+}
+
+const void *spool_reader_next(struct spool_reader *r, uint8_t *type, uint32_t *len)
+{
+    if (!r || !type || !len) {
+        return NULL;
+    }
+
+    for (;;) {
+        if (!r->map && reader_open_segment(r) != 0) {
+            return NULL; // Next segment not written yet
+        }
+
+        if (r->offset + sizeof(struct wire_frame_hdr) > r->seg_size) {
+            reader_next_segment(r);
+            continue;
+        }
+
+        uint16_t magic = __atomic_load_n((const uint16_t *)(r->map + r->offset),
+                                         __ATOMIC_ACQUIRE);
+        const struct wire_frame_hdr *hdr =
+            (const struct wire_frame_hdr *)(r->map + r->offset);
+
+        if (magic == 0) {
+            // End of written data. If a newer segment exists the producer
+            // crashed without sealing this one; skip forward.
+            char path[512];
+            struct stat st;
+            seg_path(r->dir, r->seq + 1, path, sizeof(path));
+            if (stat(path, &st) == 0) {
+                reader_next_segment(r);
+                continue;
+            }
+            return NULL; // Caught up with the producer
+        }
+
+        if (magic != WIRE_MAGIC) {
+            fprintf(stderr, "WARNING: corrupt spool frame in segment %" PRIu64 ", skipping\n",
+                    r->seq);
+            reader_next_segment(r);
+            continue;
+        }
+
+        if (hdr->type == SPOOL_REC_SEAL) {
+            reader_next_segment(r);
+            continue;
+        }
+
+        *type = hdr->type;
+        *len = hdr->length;
+        return r->map + r->offset + sizeof(*hdr);
+    }
+}
+
+void spool_reader_advance(struct spool_reader *r)
+{
+    const struct wire_frame_hdr *hdr;
+    size_t total;
+
+    if (!r || !r->map) {
+        return;
+    }
+
+    hdr = (const struct wire_frame_hdr *)(r->map + r->offset);
+    total = sizeof(*hdr) + hdr->length;
+    total = (total + SPOOL_ALIGN - 1) & ~(size_t)(SPOOL_ALIGN - 1);
+    r->offset += total;
+}
+
+int spool_reader_commit(struct spool_reader *r)
+{
+    char tmp[512];
+    char path[512];
+    FILE *fp;
+
+    if (!r) {
+        return -1;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s/commit.tmp", r->dir);
+    commit_path(r->dir, path, sizeof(path));
+
+    fp = fopen(tmp, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "%" PRIu64 " %" PRIu64 "\n", r->seq, (uint64_t)r->offset);
+    fclose(fp);
+
+    // Atomic rename: the commit file is always complete or absent
+    if (rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+void spool_reader_close(struct spool_reader *r)
+{
+    if (!r) {
+        return;
+    }
+    reader_close_segment(r);
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Store-and-forward mmap spool between tracers and the ingestion side
+//
+// When the ingestion daemon is down, writing to a pipe blocks the loader
+// or kills it with SIGPIPE, and every kernel event from the outage
+// window is lost. The spool instead appends binary wire frames to
+// memory-mapped, size-capped segment files in a directory; the consumer
+// tails the segments at its own pace and persists a committed offset, so
+// a restart resumes exactly where it left off. Segments are preallocated
+// with fallocate so appends never block on allocation, and old segments
+// are recycled once the cap is reached - a long outage costs the oldest
+// data, never the loader.
+//
+// Segment layout: a spool_seg_hdr followed by wire frames (the same
+// header layout wire.h and ipc_ring.h use). Preallocation zero-fills the
+// file, so a zero frame magic marks the end of written data; a frame of
+// type SPOOL_REC_SEAL tells the reader the producer has moved on to the
+// next segment.
+
+#ifndef KERNELSIGHT_SPOOL_H
+#define KERNELSIGHT_SPOOL_H
+
+#include "wire.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPOOL_SEG_MAGIC 0x4B535053 // "KSPS"
+#define SPOOL_SEG_VERSION 1
+
+// Frame type marking the end of a sealed segment; readers continue with
+// the next sequence number
+#define SPOOL_REC_SEAL 0xFF
+
+// Default segment geometry: 8 x 16MB caps the spool at 128MB on disk
+#define SPOOL_DEFAULT_SEG_SIZE (16 * 1024 * 1024)
+#define SPOOL_DEFAULT_MAX_SEGMENTS 8
+
+// Header at the start of every segment file
+struct spool_seg_hdr {
+    uint32_t magic;   // SPOOL_SEG_MAGIC
+    uint32_t version; // SPOOL_SEG_VERSION
+    uint64_t seq;     // Segment sequence number
+};
+
+// Producer side: one mapped append-only segment at a time
+struct spool_writer {
+    char dir[256];             // Spool directory
+    uint64_t seq;              // Current segment sequence number
+    uint8_t *map;              // Current segment mapping
+    size_t seg_size;           // Segment file size
+    size_t offset;             // Append offset within the segment
+    unsigned int max_segments; // Recycle segments beyond this count
+    int fd;                    // Current segment file descriptor
+    uint64_t recycled;         // Segments deleted before being consumed
+};
+
+// Consumer side: tails segments in sequence order
+struct spool_reader {
+    char dir[256];   // Spool directory
+    uint64_t seq;    // Current segment sequence number
+    uint8_t *map;    // Current segment mapping
+    size_t seg_size; // Segment file size
+    size_t offset;   // Read offset within the segment
+    int fd;          // Current segment file descriptor
+};
+
+/**
+ * Open a spool directory for writing and start a fresh segment
+ * The directory is created if missing; writing always starts after the
+ * highest existing sequence number so a restarted producer never
+ * clobbers unconsumed data.
+ * @param w Writer to initialize
+ * @param dir Spool directory (e.g., /var/spool/kernelsight/syscall)
+ * @param seg_size Segment file size in bytes (0 for SPOOL_DEFAULT_SEG_SIZE)
+ * @param max_segments Segments kept before recycling the oldest
+ *                     (0 for SPOOL_DEFAULT_MAX_SEGMENTS)
+ * @return 0 on success, -1 on error
+ */
+int spool_writer_open(struct spool_writer *w, const char *dir, size_t seg_size,
+                      unsigned int max_segments);
+
+/**
+ * Append one record to the spool (rotating segments as needed)
+ * The frame magic is published last with release ordering, so a
+ * concurrent tailer never observes a partially written frame.
+ * @param w Writer
+ * @param type Record type (enum wire_record_type)
+ * @param payload Record payload
+ * @param len Payload length in bytes
+ * @return 0 on success, -1 on error
+ */
+int spool_write_record(struct spool_writer *w, uint8_t type, const void *payload, uint32_t len);
+
+/**
+ * Unmap and close the current segment
+ * @param w Writer to tear down
+ */
+void spool_writer_close(struct spool_writer *w);
+
+/**
+ * Open a spool directory for tailing
+ * Resumes from the committed offset if one was persisted, otherwise
+ * starts at the oldest segment still on disk.
+ * @param r Reader to initialize
+ * @param dir Spool directory written by a producer
+ * @return 0 on success, -1 on error (no directory and no commit state)
+ */
+int spool_reader_open(struct spool_reader *r, const char *dir);
+
+/**
+ * Peek the next record in place (following seals into newer segments)
+ * The returned pointer is valid until spool_reader_advance().
+ * @param r Reader
+ * @param type Output record type
+ * @param len Output payload length in bytes
+ * @return Pointer to the payload, or NULL when caught up with the producer
+ */
+const void *spool_reader_next(struct spool_reader *r, uint8_t *type, uint32_t *len);
+
+/**
+ * Step past the record returned by spool_reader_next()
+ * @param r Reader
+ */
+void spool_reader_advance(struct spool_reader *r);
+
+/**
+ * Persist the current read position (atomic rename of a commit file)
+ * @param r Reader
+ * @return 0 on success, -1 on error
+ */
+int spool_reader_commit(struct spool_reader *r);
+
+/**
+ * Unmap and close the current segment
+ * @param r Reader to tear down
+ */
+void spool_reader_close(struct spool_reader *r);
+
+#endif // KERNELSIGHT_SPOOL_H
@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Batched wire output implementation
+// See wire.h for the frame format and flushing policy.
+
+#include "wire.h"
+#include "hotpath.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define NSEC_PER_MSEC 1000000ULL
+
+// Write-stall histogram shared by every writer in the process; a slow
+// or backpressured consumer shows up here as a fat flush tail
+static struct hotpath_hist flush_hist;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int wire_writer_init(struct wire_writer *w, int fd, enum wire_format format, size_t buf_size,
+                     unsigned int flush_interval_ms)
+{
+    if (!w) {
+        return -1;
+    }
+
+    memset(w, 0, sizeof(*w));
+
+    if (buf_size == 0) {
+        buf_size = WIRE_DEFAULT_BUF_SIZE;
+    }
+    if (flush_interval_ms == 0) {
+        flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
+    }
+
+    w->buf = malloc(buf_size);
+    if (!w->buf) {
+        return -1;
+    }
+
+    w->fd = fd;
+    w->format = format;
+    w->buf_cap = buf_size;
+    w->flush_interval = (uint64_t)flush_interval_ms * NSEC_PER_MSEC;
+    w->flush_deadline = monotonic_ns() + w->flush_interval;
+
+    if (!flush_hist.name) {
+        hotpath_register(&flush_hist, "wire_flush");
+    }
+
+    return 0;
+}
+
+int wire_writer_enable_compression(struct wire_writer *w, const char *codec)
+{
+    if (!w || !codec) {
+        return -1;
+    }
+
+    if (strcmp(codec, "zstd") != 0) {
+        fprintf(stderr, "ERROR: unknown compression codec '%s' (supported: zstd)\n", codec);
+        return -1;
+    }
+
+#ifdef HAVE_ZSTD
+    w->zctx = ZSTD_createCCtx();
+    if (!w->zctx) {
+        return -1;
+    }
+
+    w->zbuf_cap = ZSTD_compressBound(w->buf_cap);
+    w->zbuf = malloc(w->zbuf_cap);
+    if (!w->zbuf) {
+        ZSTD_freeCCtx(w->zctx);
+        w->zctx = NULL;
+        return -1;
+    }
+
+    return 0;
+#else
+    fprintf(stderr, "ERROR: built without zstd support (install libzstd-dev and rebuild)\n");
+    return -1;
+#endif
+}
+
+// Write one span to the fd, retrying on short writes and EINTR
+static int wire_write_all(struct wire_writer *w, const uint8_t *data, size_t len)
+{
+    size_t off = 0;
+    while (off < len) {
+        // Single iovec today; the writev interface lets the spool and IPC
+        // backends add header/payload segments without copying.
+        struct iovec iov = {
+            .iov_base = (uint8_t *)data + off,
+            .iov_len = len - off,
+        };
+
+        ssize_t n = writev(w->fd, &iov, 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        off += (size_t)n;
+    }
+
+    return 0;
+}
+
+int wire_flush(struct wire_writer *w)
+{
+    if (!w || !w->buf) {
+        return -1;
+    }
+
+    const uint8_t *out = w->buf;
+    size_t out_len = w->buf_len;
+
+#ifdef HAVE_ZSTD
+    // Each flush becomes one complete zstd frame: the batch boundary is
+    // a record boundary, so a consumer decodes frame by frame as the
+    // stream arrives instead of waiting for the producer to exit
+    if (w->zctx && w->buf_len > 0) {
+        size_t zlen = ZSTD_compress2(w->zctx, w->zbuf, w->zbuf_cap, w->buf, w->buf_len);
+        if (ZSTD_isError(zlen)) {
+            fprintf(stderr, "ERROR: zstd compression failed: %s\n", ZSTD_getErrorName(zlen));
+            return -1;
+        }
+        w->bytes_precompress += w->buf_len;
+        out = w->zbuf;
+        out_len = zlen;
+    }
+#endif
+
+    uint64_t start = hotpath_cycles();
+    if (wire_write_all(w, out, out_len) < 0) {
+        return -1;
+    }
+    if (out_len > 0) {
+        hotpath_record(&flush_hist, start);
+    }
+
+    w->bytes_flushed += out_len;
+    if (w->buf_len > 0) {
+        w->flushes++;
+    }
+    w->buf_len = 0;
+    w->flush_deadline = monotonic_ns() + w->flush_interval;
+
+    return 0;
+}
+
+int wire_maybe_flush(struct wire_writer *w)
+{
+    if (!w || w->buf_len == 0) {
+        return 0;
+    }
+
+    if (monotonic_ns() >= w->flush_deadline) {
+        return wire_flush(w);
+    }
+
+    return 0;
+}
+
+// Append raw bytes, flushing first if they would not fit
+static int wire_append(struct wire_writer *w, const void *data, size_t len)
+{
+    if (len > w->buf_cap) {
+        return -1; // Record larger than the whole buffer
+    }
+
+    if (w->buf_len + len > w->buf_cap) {
+        if (wire_flush(w) < 0) {
+            return -1;
+        }
+    }
+
+    memcpy(w->buf + w->buf_len, data, len);
+    w->buf_len += len;
+
+    return 0;
+}
+
+int wire_write_record(struct wire_writer *w, uint8_t type, const void *payload, uint32_t len)
+{
+    if (!w || !payload) {
+        return -1;
+    }
+
+    struct wire_frame_hdr hdr = {
+        .magic = WIRE_MAGIC,
+        .version = WIRE_VERSION,
+        .type = type,
+        .length = len,
+    };
+
+    // Flush up front so header and payload land contiguously
+    if (w->buf_len + sizeof(hdr) + len > w->buf_cap) {
+        if (wire_flush(w) < 0) {
+            return -1;
+        }
+    }
+
+    if (wire_append(w, &hdr, sizeof(hdr)) < 0) {
+        return -1;
+    }
+    if (wire_append(w, payload, len) < 0) {
+        return -1;
+    }
+
+    w->records_written++;
+    return 0;
+}
+
+int wire_write_json(struct wire_writer *w, const char *line, size_t len)
+{
+    if (!w || !line) {
+        return -1;
+    }
+
+    if (w->buf_len + len + 1 > w->buf_cap) {
+        if (wire_flush(w) < 0) {
+            return -1;
+        }
+    }
+
+    if (wire_append(w, line, len) < 0) {
+        return -1;
+    }
+    if (wire_append(w, "\n", 1) < 0) {
+        return -1;
+    }
+
+    w->records_written++;
+    return 0;
+}
+
+void wire_writer_destroy(struct wire_writer *w)
+{
+    if (!w) {
+        return;
+    }
+
+    wire_flush(w);
+#ifdef HAVE_ZSTD
+    if (w->zctx) {
+        ZSTD_freeCCtx(w->zctx);
+        w->zctx = NULL;
+    }
+#endif
+    free(w->zbuf);
+    w->zbuf = NULL;
+    free(w->buf);
+    w->buf = NULL;
+}
+
+// Process-wide sink for the scraper modules' print_*_json() helpers
+static struct wire_writer *line_sink;
+
+void wire_set_line_sink(struct wire_writer *w)
+{
+    line_sink = w;
+}
+
+int wire_emit_line(const char *line, size_t len)
+{
+    if (line_sink) {
+        return wire_write_json(line_sink, line, len);
+    }
+
+    // No sink registered: the historical unbuffered-stdout path
+    if (fwrite(line, 1, len, stdout) != len || fputc('\n', stdout) == EOF) {
+        return -1;
+    }
+    fflush(stdout);
+    return 0;
+}
+
+int wire_format_from_string(const char *arg, enum wire_format *format)
+{
+    if (!arg || !format) {
+        return -1;
+    }
+
+    if (strcmp(arg, "binary") == 0) {
+        *format = WIRE_FORMAT_BINARY;
+        return 0;
+    }
+    if (strcmp(arg, "json") == 0) {
+        *format = WIRE_FORMAT_JSON;
+        return 0;
+    }
+
+    return -1;
+}
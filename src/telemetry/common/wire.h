@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Batched wire output shared by all tracer loaders
+//
+// Events are accumulated in a userspace buffer and flushed with a single
+// writev() when the buffer fills or a flush deadline passes, instead of
+// one printf+fflush per event. Two formats are supported:
+//   - binary: length-prefixed frames (default, cheap to produce and parse)
+//   - JSON:   the original JSONL records, kept as a compatibility mode
+
+#ifndef KERNELSIGHT_WIRE_H
+#define KERNELSIGHT_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Output format selection
+enum wire_format {
+    WIRE_FORMAT_BINARY = 0, // Length-prefixed binary frames
+    WIRE_FORMAT_JSON = 1,   // Newline-delimited JSON (compatibility mode)
+};
+
+// Record types carried in binary frame headers
+enum wire_record_type {
+    WIRE_REC_SYSCALL = 1,   // struct syscall_event
+    WIRE_REC_SCHED = 2,     // struct bucket_stats
+    WIRE_REC_PAGEFAULT = 3, // struct page_fault_event
+    WIRE_REC_IO = 4,          // struct io_stats_record
+    WIRE_REC_SYSCALL_AGG = 5, // struct syscall_agg_record
+    WIRE_REC_SELF = 6,        // struct self_telemetry_record
+};
+
+// Binary frame header preceding every record payload
+// All fields are host-endian; producer and consumer share a host.
+struct wire_frame_hdr {
+    uint16_t magic;   // WIRE_MAGIC
+    uint8_t version;  // WIRE_VERSION
+    uint8_t type;     // enum wire_record_type
+    uint32_t length;  // Payload length in bytes (header excluded)
+} __attribute__((packed));
+
+#define WIRE_MAGIC 0x4B53 // "KS"
+#define WIRE_VERSION 1
+
+// Defaults tuned for ~50k events/sec without unbounded latency
+#define WIRE_DEFAULT_BUF_SIZE (256 * 1024)
+#define WIRE_DEFAULT_FLUSH_MS 100
+
+// Buffered writer state. One per output stream; not thread-safe.
+struct wire_writer {
+    int fd;                   // Output file descriptor
+    enum wire_format format;  // Binary or JSON
+    uint8_t *buf;             // Accumulation buffer
+    size_t buf_len;           // Bytes currently buffered
+    size_t buf_cap;           // Buffer capacity
+    uint64_t flush_deadline;  // Monotonic ns of next forced flush
+    uint64_t flush_interval;  // Flush interval in ns
+    uint64_t records_written; // Total records accepted
+    uint64_t bytes_flushed;   // Total bytes written to fd
+    uint64_t flushes;         // Number of writev() calls issued
+    // Optional streaming compression (--compress); NULL when disabled
+    void *zctx;             // ZSTD_CCtx, kept opaque so zstd.h stays out of this header
+    uint8_t *zbuf;          // Compressed-frame staging buffer
+    size_t zbuf_cap;        // ZSTD_compressBound(buf_cap)
+    uint64_t bytes_precompress; // Uncompressed bytes accepted (ratio accounting)
+};
+
+/**
+ * Initialize a buffered writer on a file descriptor
+ * @param w Writer to initialize
+ * @param fd Output file descriptor (typically STDOUT_FILENO)
+ * @param format Binary frames or JSON compatibility mode
+ * @param buf_size Accumulation buffer size in bytes (0 for default)
+ * @param flush_interval_ms Max time a record may sit buffered (0 for default)
+ * @return 0 on success, -1 on allocation failure
+ */
+int wire_writer_init(struct wire_writer *w, int fd, enum wire_format format, size_t buf_size,
+                     unsigned int flush_interval_ms);
+
+/**
+ * Enable streaming compression on an initialized writer (--compress)
+ * Must be called before the first record is written. Every flush ends a
+ * complete compressed frame, so frame boundaries coincide with record
+ * boundaries and a consumer can decode incrementally (or just pipe the
+ * stream through zstd -d).
+ * @param w Writer
+ * @param codec Codec name; only "zstd" is supported
+ * @return 0 on success, -1 on an unknown codec or a build without zstd
+ */
+int wire_writer_enable_compression(struct wire_writer *w, const char *codec);
+
+/**
+ * Append one binary record (frame header + payload) to the buffer
+ * Flushes first if the record would not fit.
+ * @param w Writer
+ * @param type Record type (enum wire_record_type)
+ * @param payload Record payload
+ * @param len Payload length in bytes
+ * @return 0 on success, -1 on write error
+ */
+int wire_write_record(struct wire_writer *w, uint8_t type, const void *payload, uint32_t len);
+
+/**
+ * Append one JSON line (newline included by the writer) to the buffer
+ * Only valid in WIRE_FORMAT_JSON mode.
+ * @param w Writer
+ * @param line JSON record without trailing newline
+ * @param len Line length in bytes
+ * @return 0 on success, -1 on write error
+ */
+int wire_write_json(struct wire_writer *w, const char *line, size_t len);
+
+/**
+ * Flush buffered records if the flush deadline has passed
+ * Call once per loop iteration; cheap when there is nothing to do.
+ * @param w Writer
+ * @return 0 on success, -1 on write error
+ */
+int wire_maybe_flush(struct wire_writer *w);
+
+/**
+ * Flush all buffered records with a single writev()
+ * @param w Writer
+ * @return 0 on success, -1 on write error
+ */
+int wire_flush(struct wire_writer *w);
+
+/**
+ * Flush and release writer resources
+ * @param w Writer
+ */
+void wire_writer_destroy(struct wire_writer *w);
+
+/**
+ * Register a process-wide sink for scraper-style JSON lines
+ * The print_*_json() helpers in the scraper modules route through the
+ * registered writer (sharing its batching and compression) instead of
+ * writing to stdout directly. NULL restores the direct-stdout path.
+ * @param w JSON-mode writer, or NULL
+ */
+void wire_set_line_sink(struct wire_writer *w);
+
+/**
+ * Emit one JSON line via the registered sink, or unbuffered to stdout
+ * when no sink is registered
+ * @param line JSON record without trailing newline
+ * @param len Line length in bytes
+ * @return 0 on success, -1 on write error
+ */
+int wire_emit_line(const char *line, size_t len);
+
+/**
+ * Parse a format flag value ("binary" or "json")
+ * @param arg Flag value
+ * @param format Output format on success
+ * @return 0 on success, -1 if arg is not a known format
+ */
+int wire_format_from_string(const char *arg, enum wire_format *format);
+
+#endif // KERNELSIGHT_WIRE_H
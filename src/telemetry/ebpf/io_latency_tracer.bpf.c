@@ -12,17 +12,32 @@
 #include <bpf/bpf_helpers.h>
 #include <bpf/bpf_tracing.h>
 
-#define MAX_SLOTS 32 // Log2 histogram slots (covers 0 to 2^31 microseconds)
-
-// Histogram for latency distribution (log2 buckets)
+// Log-linear sketch geometry: each power-of-two octave is split into 32
+// linear sub-buckets, equivalent to a DDSketch with gamma = 2^(1/32)
+// (~1.022), so every quantile carries at most ~1.6% relative error
+// instead of the factor-of-two a plain log2 histogram gives. Values
+// below 32us land in exact 1us buckets; values at or above 2^22us
+// (~4.2s) collapse into the top slot.
+#define IO_HIST_SUB_BITS 5
+#define IO_HIST_SUB (1 << IO_HIST_SUB_BITS)
+#define IO_HIST_MAX_EXP 22
+#define IO_HIST_SLOTS ((IO_HIST_MAX_EXP - IO_HIST_SUB_BITS + 1) * IO_HIST_SUB)
+
+// Histogram for latency distribution (log-linear buckets)
 struct hist {
-    __u32 slots[MAX_SLOTS];
+    __u32 slots[IO_HIST_SLOTS];
 };
 
-// Per-operation statistics
+// Per-operation statistics. The read/write hists measure D2C (issue to
+// complete, device service time); the q2c hists measure Q2C (insert to
+// complete), which additionally includes block-layer queueing. A normal
+// D2C p99 with an elevated Q2C p99 means the device is fine and requests
+// are waiting in the queue.
 struct io_stats {
     struct hist read_hist;
     struct hist write_hist;
+    struct hist read_q2c_hist;
+    struct hist write_q2c_hist;
     __u64 read_count;
     __u64 write_count;
     __u64 read_bytes;
@@ -57,10 +72,32 @@ struct {
     __type(value, struct io_start);
 } io_start_map SEC(".maps");
 
-// Per-CPU array for statistics (lock-free updates)
+// Insert timestamps for Q2C, same keying as io_start_map. Requests that
+// bypass the queue (issued without an insert) simply have no entry here
+// and contribute to D2C only.
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 10240);
+    __type(key, struct request_key);
+    __type(value, struct io_start);
+} io_insert_map SEC(".maps");
+
+// Instantaneous per-device queue depth: incremented at insert,
+// decremented at complete (only for requests whose insert was seen).
+// Read by the loader as a gauge; never drained.
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 64);
+    __type(key, __u32);
+    __type(value, __s64);
+} io_inflight_map SEC(".maps");
+
+// Per-CPU hash keyed by device (lock-free updates, one entry per disk).
+// A global aggregate would let one slow boot disk poison the percentiles
+// of every other device, so each dev_t gets its own histograms.
 struct {
-    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
-    __uint(max_entries, 1);
+    __uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+    __uint(max_entries, 64);
     __type(key, __u32);
     __type(value, struct io_stats);
 } io_stats_map SEC(".maps");
@@ -93,11 +130,28 @@ static __always_inline __u32 log2(__u64 v)
         }
     }
 
-    if (slot >= MAX_SLOTS) {
-        slot = MAX_SLOTS - 1;
+    return slot;
+}
+
+// Map a latency in microseconds to its log-linear sketch slot: the top
+// bits pick the octave, the next IO_HIST_SUB_BITS bits of the mantissa
+// pick the linear sub-bucket inside it. Pure shifts and adds, so the
+// verifier sees a short branch-free tail after the log2 scan.
+static __always_inline __u32 io_hist_slot(__u64 us)
+{
+    if (us < IO_HIST_SUB) {
+        return (__u32)us; // Exact 1us buckets below 32us
     }
 
-    return slot;
+    __u32 exp = log2(us);
+    if (exp >= IO_HIST_MAX_EXP) {
+        return IO_HIST_SLOTS - 1; // Clamp outliers into the top slot
+    }
+
+    // Sub-bucket = next 5 mantissa bits below the leading one
+    __u32 sub = (__u32)(us >> (exp - IO_HIST_SUB_BITS)) - IO_HIST_SUB;
+
+    return ((exp - IO_HIST_SUB_BITS + 1) << IO_HIST_SUB_BITS) + sub;
 }
 
 // Tracepoint context for block_rq_issue
@@ -112,6 +166,18 @@ struct trace_event_raw_block_rq_issue {
     __u64 __data_loc_cmd;
 };
 
+// Tracepoint context for block_rq_insert (same layout as block_rq_issue)
+struct trace_event_raw_block_rq_insert {
+    __u64 unused;
+    __u32 dev;
+    __u64 sector;
+    __u32 nr_sector;
+    __u32 bytes;
+    char rwbs[8];
+    char comm[16];
+    __u64 __data_loc_cmd;
+};
+
 // Tracepoint context for block_rq_complete
 struct trace_event_raw_block_rq_complete {
     __u64 unused;
@@ -123,6 +189,38 @@ struct trace_event_raw_block_rq_complete {
     __u64 __data_loc_cmd;
 };
 
+// Tracepoint: block_rq_insert - when request enters the block-layer queue
+SEC("tp/block/block_rq_insert")
+int trace_block_rq_insert(struct trace_event_raw_block_rq_insert *ctx)
+{
+    struct request_key key = {
+        .dev = ctx->dev,
+        .sector = ctx->sector,
+    };
+
+    struct io_start start = {.timestamp = bpf_ktime_get_ns()};
+
+    bpf_map_update_elem(&io_insert_map, &key, &start, BPF_ANY);
+
+    // Bump the device's queue-depth gauge, creating it on first insert
+    __u32 dev = ctx->dev;
+    __s64 *depth = bpf_map_lookup_elem(&io_inflight_map, &dev);
+    if (depth) {
+        __sync_fetch_and_add(depth, 1);
+    } else {
+        __s64 one = 1;
+        if (bpf_map_update_elem(&io_inflight_map, &dev, &one, BPF_NOEXIST) != 0) {
+            // Lost the creation race to another CPU; add to its entry
+            depth = bpf_map_lookup_elem(&io_inflight_map, &dev);
+            if (depth) {
+                __sync_fetch_and_add(depth, 1);
+            }
+        }
+    }
+
+    return 0;
+}
+
 // Tracepoint: block_rq_issue - when request is issued
 SEC("tp/block/block_rq_issue")
 int trace_block_rq_issue(struct trace_event_raw_block_rq_issue *ctx)
@@ -150,48 +248,70 @@ int trace_block_rq_complete(struct trace_event_raw_block_rq_complete *ctx)
         .sector = ctx->sector,
     };
 
-    // Lookup start time
+    // Lookup issue (D2C) and insert (Q2C) timestamps
     struct io_start *start = bpf_map_lookup_elem(&io_start_map, &key);
-    if (!start) {
-        return 0; // No start time tracked
+    struct io_start *qstart = bpf_map_lookup_elem(&io_insert_map, &key);
+    if (!start && !qstart) {
+        return 0; // Request predates attach
     }
 
-    // Calculate latency in nanoseconds
     __u64 end_ts = bpf_ktime_get_ns();
-    __u64 latency_ns = end_ts - start->timestamp;
 
-    // Convert to microseconds for histogram
-    __u64 latency_us = latency_ns / 1000;
+    // Convert to microseconds for the histograms
+    __u64 latency_us = start ? (end_ts - start->timestamp) / 1000 : 0;
+    __u64 q2c_us = qstart ? (end_ts - qstart->timestamp) / 1000 : 0;
 
     // Determine if read or write from rwbs string
     // 'R' = read, 'W' = write
     char op = ctx->rwbs[0];
     int is_read = (op == 'R');
 
-    // Get per-CPU stats
-    __u32 stats_key = 0;
+    // Get this device's per-CPU stats, creating the entry on first I/O
+    __u32 stats_key = ctx->dev;
     struct io_stats *stats = bpf_map_lookup_elem(&io_stats_map, &stats_key);
     if (!stats) {
-        goto cleanup;
+        struct io_stats zero = {};
+        bpf_map_update_elem(&io_stats_map, &stats_key, &zero, BPF_NOEXIST);
+        stats = bpf_map_lookup_elem(&io_stats_map, &stats_key);
+        if (!stats) {
+            goto cleanup;
+        }
     }
 
-    // Calculate histogram slot (log2)
-    __u32 slot = log2(latency_us);
-
-    // Update histogram and counters
+    // Update histograms and counters (D2C when the issue was seen, Q2C
+    // when the insert was seen; counts and bytes follow D2C as before)
     if (is_read) {
-        __sync_fetch_and_add(&stats->read_hist.slots[slot], 1);
-        __sync_fetch_and_add(&stats->read_count, 1);
-        __sync_fetch_and_add(&stats->read_bytes, ctx->nr_sector * 512);
+        if (start) {
+            __sync_fetch_and_add(&stats->read_hist.slots[io_hist_slot(latency_us)], 1);
+            __sync_fetch_and_add(&stats->read_count, 1);
+            __sync_fetch_and_add(&stats->read_bytes, ctx->nr_sector * 512);
+        }
+        if (qstart) {
+            __sync_fetch_and_add(&stats->read_q2c_hist.slots[io_hist_slot(q2c_us)], 1);
+        }
     } else {
-        __sync_fetch_and_add(&stats->write_hist.slots[slot], 1);
-        __sync_fetch_and_add(&stats->write_count, 1);
-        __sync_fetch_and_add(&stats->write_bytes, ctx->nr_sector * 512);
+        if (start) {
+            __sync_fetch_and_add(&stats->write_hist.slots[io_hist_slot(latency_us)], 1);
+            __sync_fetch_and_add(&stats->write_count, 1);
+            __sync_fetch_and_add(&stats->write_bytes, ctx->nr_sector * 512);
+        }
+        if (qstart) {
+            __sync_fetch_and_add(&stats->write_q2c_hist.slots[io_hist_slot(q2c_us)], 1);
+        }
     }
 
 cleanup:
-    // Remove from tracking map
-    bpf_map_delete_elem(&io_start_map, &key);
+    // Remove from the tracking maps and settle the queue-depth gauge
+    if (start) {
+        bpf_map_delete_elem(&io_start_map, &key);
+    }
+    if (qstart) {
+        bpf_map_delete_elem(&io_insert_map, &key);
+        __s64 *depth = bpf_map_lookup_elem(&io_inflight_map, &stats_key);
+        if (depth) {
+            __sync_fetch_and_add(depth, -1);
+        }
+    }
 
     return 0;
 }
@@ -4,9 +4,20 @@
 // Userspace loader for I/O latency tracer
 // Aggregates histogram data and calculates percentiles
 
+#include "../common/self_telemetry.h"
+#include "../common/ipc_ring.h"
+#include "../common/hotpath.h"
+#include "../common/realtime.h"
+#include "../common/replay.h"
+#include "../common/spool.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+// Generated BPF skeleton: embeds the BPF object and provides typed map access
+#include "io_latency_tracer.skel.h"
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 #include <errno.h>
+#include <getopt.h>
 #include <math.h>
 #include <signal.h>
 #include <stdio.h>
@@ -15,30 +26,115 @@
 #include <time.h>
 #include <unistd.h>
 
-#define MAX_SLOTS 32
+// Log-linear sketch geometry (must match BPF program): 32 linear
+// sub-buckets per power-of-two octave, i.e. DDSketch gamma = 2^(1/32)
+// (~1.022), bounding quantile relative error at ~1.6%
+#define IO_HIST_SUB_BITS 5
+#define IO_HIST_SUB (1 << IO_HIST_SUB_BITS)
+#define IO_HIST_MAX_EXP 22
+#define IO_HIST_SLOTS ((IO_HIST_MAX_EXP - IO_HIST_SUB_BITS + 1) * IO_HIST_SUB)
 
 // Histogram structure (must match BPF program)
 struct hist {
-    unsigned int slots[MAX_SLOTS];
+    unsigned int slots[IO_HIST_SLOTS];
 };
 
-// Per-operation statistics (must match BPF program)
+// Per-operation statistics (must match BPF program). read/write hists
+// are D2C (issue to complete); the q2c hists are Q2C (insert to
+// complete), which adds block-layer queue time.
 struct io_stats {
     struct hist read_hist;
     struct hist write_hist;
+    struct hist read_q2c_hist;
+    struct hist write_q2c_hist;
     unsigned long long read_count;
     unsigned long long write_count;
     unsigned long long read_bytes;
     unsigned long long write_bytes;
 };
 
+// Binary wire record for one device's stats interval (WIRE_REC_IO payload)
+struct io_stats_record {
+    unsigned long long timestamp;
+    unsigned int interval_seconds;
+    unsigned int dev;
+    char device[32];
+    unsigned long long read_count;
+    unsigned long long read_bytes;
+    unsigned long long write_count;
+    unsigned long long write_bytes;
+    double read_p50_us;
+    double read_p95_us;
+    double read_p99_us;
+    double read_max_us;
+    double write_p50_us;
+    double write_p95_us;
+    double write_p99_us;
+    double write_max_us;
+    double read_q2c_p50_us;
+    double read_q2c_p99_us;
+    double write_q2c_p50_us;
+    double write_q2c_p99_us;
+    long long queue_depth;
+};
+
+#define MAX_DEVICES 64
+
 static volatile sig_atomic_t exiting = 0;
 
+// Batched output writer shared by the JSON and binary emit paths
+static struct wire_writer wire;
+
+// Shared-memory ring transport (--ipc); NULL path means stdout only
+static struct ipc_ring ipc;
+static int ipc_active;
+
+// Store-and-forward segment spool (--spool); survives consumer restarts
+static struct spool_writer spool;
+static int spool_active;
+
+// Route one binary record to the spool or shared-memory ring when active,
+// otherwise to the batched stdout writer
+static void emit_record(uint8_t type, const void *payload, uint32_t len)
+{
+    if (spool_active) {
+        spool_write_record(&spool, type, payload, len);
+    } else if (ipc_active) {
+        ipc_ring_write(&ipc, type, payload, len);
+    } else {
+        wire_write_record(&wire, type, payload, len);
+    }
+}
+
+// Loader health, emitted on the same stream. This tracer aggregates in a
+// per-CPU map instead of a ring buffer, so there is no kernel drop path;
+// events_consumed counts emitted stats intervals.
+static struct self_telemetry selftel;
+
+// Cycle histogram for the per-interval map drain (--stats-socket / USDT)
+static struct hotpath_hist drain_hist;
+
 static void sig_handler(int sig)
 {
     exiting = 1;
 }
 
+// Lower bound in microseconds of a sketch slot: inverse of the BPF-side
+// io_hist_slot() mapping. Passing IO_HIST_SLOTS yields the sketch's
+// upper range bound, so slot_lower_bound(i + 1) is always bucket i's
+// upper edge.
+static double slot_lower_bound(int slot)
+{
+    if (slot < IO_HIST_SUB) {
+        return (double)slot;
+    }
+
+    int exp = (slot >> IO_HIST_SUB_BITS) + IO_HIST_SUB_BITS - 1;
+    int sub = slot & (IO_HIST_SUB - 1);
+
+    return (double)((unsigned long long)(IO_HIST_SUB + sub) << (exp - IO_HIST_SUB_BITS));
+}
+
 // Calculate percentile from histogram
 static double calculate_percentile(const struct hist *h, unsigned long long total,
                                    double percentile)
@@ -50,53 +146,176 @@ static double calculate_percentile(const struct hist *h, unsigned long long tota
     unsigned long long target = (unsigned long long)(total * percentile / 100.0);
     unsigned long long cumulative = 0;
 
-    for (int i = 0; i < MAX_SLOTS; i++) {
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
         cumulative += h->slots[i];
 
         if (cumulative >= target) {
-            // Found the bucket containing our percentile
-            // Bucket i represents range [2^i, 2^(i+1))
-            // Interpolate within the bucket
-            unsigned long long bucket_start = (i == 0) ? 0 : (1ULL << i);
-            unsigned long long bucket_end = (1ULL << (i + 1));
-
-            // Simple midpoint approximation
-            double value = (bucket_start + bucket_end) / 2.0;
-
-            return value;
+            // Found the bucket containing our percentile. Sketch buckets
+            // are at most 1/32 of their value wide, so the midpoint is
+            // within ~1.6% of any sample that landed here.
+            return (slot_lower_bound(i) + slot_lower_bound(i + 1)) / 2.0;
         }
     }
 
     // If we get here, return the max value
-    return (1ULL << MAX_SLOTS) / 2.0;
+    return (double)(1ULL << IO_HIST_MAX_EXP);
 }
 
 // Get max latency from histogram
 static double get_max_latency(const struct hist *h)
 {
-    for (int i = MAX_SLOTS - 1; i >= 0; i--) {
+    for (int i = IO_HIST_SLOTS - 1; i >= 0; i--) {
         if (h->slots[i] > 0) {
             // Return the upper bound of this bucket
-            return (double)(1ULL << (i + 1));
+            return slot_lower_bound(i + 1);
         }
     }
     return 0.0;
 }
 
-// Print JSON stats as single line (JSONL format)
-static void print_stats(const struct io_stats *stats, unsigned long long timestamp)
+// Resolve a kernel dev_t (MKDEV encoding: major << 20 | minor) to a device
+// name via the /sys/dev/block symlink, caching results across intervals
+static const char *resolve_device_name(unsigned int dev)
+{
+    static struct {
+        unsigned int dev;
+        char name[32];
+    } cache[MAX_DEVICES];
+    static int cache_count = 0;
+
+    for (int i = 0; i < cache_count; i++) {
+        if (cache[i].dev == dev) {
+            return cache[i].name;
+        }
+    }
+
+    unsigned int major = dev >> 20;
+    unsigned int minor = dev & 0xFFFFF;
+    char path[64];
+    char target[256];
+    char name[32];
+
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u", major, minor);
+    ssize_t len = readlink(path, target, sizeof(target) - 1);
+    if (len > 0) {
+        target[len] = '\0';
+        const char *base = strrchr(target, '/');
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : target);
+    } else {
+        // No sysfs entry (device gone?) - fall back to major:minor
+        snprintf(name, sizeof(name), "%u:%u", major, minor);
+    }
+
+    if (cache_count < MAX_DEVICES) {
+        cache[cache_count].dev = dev;
+        snprintf(cache[cache_count].name, sizeof(cache[cache_count].name), "%s", name);
+        return cache[cache_count++].name;
+    }
+
+    // Cache full: return an uncached static copy (rare, 64+ devices)
+    static char overflow[32];
+    snprintf(overflow, sizeof(overflow), "%s", name);
+    return overflow;
+}
+
+// Sum a histogram's buckets; the Q2C hists have no kernel-side counter
+// because their totals can differ from the D2C counts (queue-bypassing
+// requests land in D2C only)
+static unsigned long long hist_total(const struct hist *h)
+{
+    unsigned long long total = 0;
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
+        total += h->slots[i];
+    }
+    return total;
+}
+
+// Serialize one stats record (binary frame or JSONL line). Both live
+// intervals and replayed captures pass through here.
+static void emit_io_record(const struct io_stats_record *rec)
 {
     struct tm *tm;
     time_t t;
     char ts_str[64];
+    char line[768];
+    int len;
 
-    t = timestamp / 1000000000;
+    // Binary mode: forward the fixed-layout record as one frame
+    if (wire.format == WIRE_FORMAT_BINARY) {
+        emit_record(WIRE_REC_IO, rec, sizeof(*rec));
+        return;
+    }
+
+    t = rec->timestamp / 1000000000;
     tm = localtime(&t);
     strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
 
+    // Serialize as single-line JSON (JSONL format)
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", rec->timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_str(&jw, "device", rec->device);
+    json_u64(&jw, "interval_seconds", rec->interval_seconds);
+    json_u64(&jw, "read_count", rec->read_count);
+    json_u64(&jw, "read_bytes", rec->read_bytes);
+    json_double(&jw, "read_p50_us", rec->read_p50_us, 2);
+    json_double(&jw, "read_p95_us", rec->read_p95_us, 2);
+    json_double(&jw, "read_p99_us", rec->read_p99_us, 2);
+    json_double(&jw, "read_max_us", rec->read_max_us, 2);
+    json_u64(&jw, "write_count", rec->write_count);
+    json_u64(&jw, "write_bytes", rec->write_bytes);
+    json_double(&jw, "write_p50_us", rec->write_p50_us, 2);
+    json_double(&jw, "write_p95_us", rec->write_p95_us, 2);
+    json_double(&jw, "write_p99_us", rec->write_p99_us, 2);
+    json_double(&jw, "write_max_us", rec->write_max_us, 2);
+    json_double(&jw, "read_q2c_p50_us", rec->read_q2c_p50_us, 2);
+    json_double(&jw, "read_q2c_p99_us", rec->read_q2c_p99_us, 2);
+    json_double(&jw, "write_q2c_p50_us", rec->write_q2c_p50_us, 2);
+    json_double(&jw, "write_q2c_p99_us", rec->write_q2c_p99_us, 2);
+    json_u64(&jw, "queue_depth",
+             rec->queue_depth < 0 ? 0 : (unsigned long long)rec->queue_depth);
+    json_str(&jw, "type", "io");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+// Replay dispatch (--replay): recorded stats records re-enter the
+// pipeline at the serialization stage (the capture holds per-interval
+// aggregates, not raw completions)
+static int replay_dispatch(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_IO || len < sizeof(struct io_stats_record)) {
+        return 0;
+    }
+    selftel.events_consumed++;
+    emit_io_record(payload);
+    return 1;
+}
+
+static uint64_t replay_record_ns(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_IO || len < sizeof(struct io_stats_record)) {
+        return 0;
+    }
+    return ((const struct io_stats_record *)payload)->timestamp;
+}
+
+// Emit one device's stats interval (binary frame or JSONL line)
+static void print_stats(unsigned int dev, const struct io_stats *stats,
+                        long long queue_depth, unsigned long long timestamp)
+{
     // Calculate percentiles
     double read_p50 = 0, read_p95 = 0, read_p99 = 0, read_max = 0;
     double write_p50 = 0, write_p95 = 0, write_p99 = 0, write_max = 0;
+    double read_q2c_p50 = 0, read_q2c_p99 = 0;
+    double write_q2c_p50 = 0, write_q2c_p99 = 0;
+    unsigned long long read_q2c_total = hist_total(&stats->read_q2c_hist);
+    unsigned long long write_q2c_total = hist_total(&stats->write_q2c_hist);
 
     if (stats->read_count > 0) {
         read_p50 = calculate_percentile(&stats->read_hist, stats->read_count, 50.0);
@@ -112,63 +331,114 @@ static void print_stats(const struct io_stats *stats, unsigned long long timesta
         write_max = get_max_latency(&stats->write_hist);
     }
 
-    // Output as single-line JSON (JSONL format)
-    printf("{\"timestamp\":%llu,\"time_str\":\"%s\",\"interval_seconds\":1,"
-           "\"read_count\":%llu,\"read_bytes\":%llu,\"read_p50_us\":%.2f,\"read_p95_us\":%.2f,"
-           "\"read_p99_us\":%.2f,\"read_max_us\":%.2f,"
-           "\"write_count\":%llu,\"write_bytes\":%llu,\"write_p50_us\":%.2f,\"write_p95_us\":%.2f,"
-           "\"write_p99_us\":%.2f,\"write_max_us\":%.2f,"
-           "\"type\":\"io\"}\n",
-           timestamp, ts_str, stats->read_count, stats->read_bytes, read_p50, read_p95, read_p99,
-           read_max, stats->write_count, stats->write_bytes, write_p50, write_p95, write_p99,
-           write_max);
-    fflush(stdout);
-}
+    if (read_q2c_total > 0) {
+        read_q2c_p50 = calculate_percentile(&stats->read_q2c_hist, read_q2c_total, 50.0);
+        read_q2c_p99 = calculate_percentile(&stats->read_q2c_hist, read_q2c_total, 99.0);
+    }
 
-// Merge per-CPU stats into a single aggregate
-static void merge_stats(int stats_map_fd, struct io_stats *merged)
-{
-    unsigned int nr_cpus = libbpf_num_possible_cpus();
-    struct io_stats *cpu_stats = calloc(nr_cpus, sizeof(struct io_stats));
-    if (!cpu_stats) {
-        return;
+    if (write_q2c_total > 0) {
+        write_q2c_p50 = calculate_percentile(&stats->write_q2c_hist, write_q2c_total, 50.0);
+        write_q2c_p99 = calculate_percentile(&stats->write_q2c_hist, write_q2c_total, 99.0);
     }
 
+    struct io_stats_record rec = {
+        .timestamp = timestamp,
+        .interval_seconds = 1,
+        .dev = dev,
+        .read_count = stats->read_count,
+        .read_bytes = stats->read_bytes,
+        .write_count = stats->write_count,
+        .write_bytes = stats->write_bytes,
+        .read_p50_us = read_p50,
+        .read_p95_us = read_p95,
+        .read_p99_us = read_p99,
+        .read_max_us = read_max,
+        .write_p50_us = write_p50,
+        .write_p95_us = write_p95,
+        .write_p99_us = write_p99,
+        .write_max_us = write_max,
+        .read_q2c_p50_us = read_q2c_p50,
+        .read_q2c_p99_us = read_q2c_p99,
+        .write_q2c_p50_us = write_q2c_p50,
+        .write_q2c_p99_us = write_q2c_p99,
+        .queue_depth = queue_depth,
+    };
+    snprintf(rec.device, sizeof(rec.device), "%s", resolve_device_name(dev));
+    emit_io_record(&rec);
+}
+
+// Merge one device's per-CPU stats into a single aggregate
+static void merge_cpu_stats(const struct io_stats *cpu_stats, unsigned int nr_cpus,
+                            struct io_stats *merged)
+{
     memset(merged, 0, sizeof(*merged));
 
-    unsigned int key = 0;
-    if (bpf_map_lookup_elem(stats_map_fd, &key, cpu_stats) == 0) {
-        // Merge all per-CPU stats
-        for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
-            merged->read_count += cpu_stats[cpu].read_count;
-            merged->write_count += cpu_stats[cpu].write_count;
-            merged->read_bytes += cpu_stats[cpu].read_bytes;
-            merged->write_bytes += cpu_stats[cpu].write_bytes;
-
-            // Merge histograms
-            for (int i = 0; i < MAX_SLOTS; i++) {
-                merged->read_hist.slots[i] += cpu_stats[cpu].read_hist.slots[i];
-                merged->write_hist.slots[i] += cpu_stats[cpu].write_hist.slots[i];
-            }
+    for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+        merged->read_count += cpu_stats[cpu].read_count;
+        merged->write_count += cpu_stats[cpu].write_count;
+        merged->read_bytes += cpu_stats[cpu].read_bytes;
+        merged->write_bytes += cpu_stats[cpu].write_bytes;
+
+        // Merge histograms (element-wise sum keeps the sketch exact)
+        for (int i = 0; i < IO_HIST_SLOTS; i++) {
+            merged->read_hist.slots[i] += cpu_stats[cpu].read_hist.slots[i];
+            merged->write_hist.slots[i] += cpu_stats[cpu].write_hist.slots[i];
+            merged->read_q2c_hist.slots[i] += cpu_stats[cpu].read_q2c_hist.slots[i];
+            merged->write_q2c_hist.slots[i] += cpu_stats[cpu].write_q2c_hist.slots[i];
         }
     }
-
-    free(cpu_stats);
 }
 
-// Clear per-CPU stats
-static void clear_stats(int stats_map_fd)
+// Walk the per-device map, emit one record per active device, then delete
+// the drained entries so each interval starts fresh. Returns the number of
+// records emitted.
+static int drain_stats(int stats_map_fd, int inflight_map_fd, unsigned long long timestamp)
 {
+    uint64_t hp_start = hotpath_cycles();
     unsigned int nr_cpus = libbpf_num_possible_cpus();
-    struct io_stats *zero_stats = calloc(nr_cpus, sizeof(struct io_stats));
-    if (!zero_stats) {
-        return;
+    unsigned int keys[MAX_DEVICES];
+    int key_count = 0;
+    int emitted = 0;
+
+    struct io_stats *cpu_stats = calloc(nr_cpus, sizeof(struct io_stats));
+    if (!cpu_stats) {
+        return 0;
     }
 
-    unsigned int key = 0;
-    bpf_map_update_elem(stats_map_fd, &key, zero_stats, BPF_ANY);
+    // Collect keys first: deleting while iterating restarts the walk
+    unsigned int key, next_key;
+    unsigned int *cur = NULL;
+    while (key_count < MAX_DEVICES && bpf_map_get_next_key(stats_map_fd, cur, &next_key) == 0) {
+        keys[key_count++] = next_key;
+        key = next_key;
+        cur = &key;
+    }
 
-    free(zero_stats);
+    for (int i = 0; i < key_count; i++) {
+        if (bpf_map_lookup_elem(stats_map_fd, &keys[i], cpu_stats) != 0) {
+            continue;
+        }
+
+        struct io_stats merged;
+        merge_cpu_stats(cpu_stats, nr_cpus, &merged);
+
+        // Read (never drain) the instantaneous queue-depth gauge
+        long long queue_depth = 0;
+        if (inflight_map_fd >= 0) {
+            bpf_map_lookup_elem(inflight_map_fd, &keys[i], &queue_depth);
+        }
+
+        if (merged.read_count > 0 || merged.write_count > 0) {
+            print_stats(keys[i], &merged, queue_depth, timestamp);
+            emitted++;
+        }
+
+        bpf_map_delete_elem(stats_map_fd, &keys[i]);
+    }
+
+    free(cpu_stats);
+    hotpath_record(&drain_hist, hp_start);
+    return emitted;
 }
 
 static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
@@ -179,18 +449,190 @@ static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va
     return 0;
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --json                 Emit JSONL records (compatibility mode)\n"
+            "  --ipc PATH             Write binary records to a shared-memory ring at PATH\n"
+            "  --spool DIR            Append binary records to mmap segment files in DIR;\n"
+            "                         the ingestion side tails and resumes after restarts\n"
+            "  --realtime             Lock all memory and prefault the stack so the\n"
+            "                         collector never page-faults under pressure\n"
+            "  --rt-cpu N             Pin to housekeeping core N (implies --realtime)\n"
+            "  --rt-fifo PRIO         Elevate to SCHED_FIFO at PRIO 1-99 (implies --realtime)\n"
+            "  --flush-interval MS    Max output buffering delay (default %d)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each flush\n"
+            "                         ends a frame so consumers can decode incrementally\n"
+            "  --replay FILE          Replay a recorded binary capture (.bin or .zst)\n"
+            "                         through the pipeline instead of tracing; no BPF\n"
+            "                         or root required\n"
+            "  --replay-timed         Pace --replay records by their recorded timestamps\n"
+            "                         (default is max speed)\n"
+            "  --stats-socket PATH    Serve a JSON snapshot of the loader's own hot-path\n"
+            "                         latency histograms per connection at PATH\n",
+            prog, WIRE_DEFAULT_FLUSH_MS);
+}
+
 int main(int argc, char **argv)
 {
-    struct bpf_object *obj = NULL;
-    struct bpf_program *prog_issue, *prog_complete;
-    struct bpf_link *link_issue = NULL, *link_complete = NULL;
+    struct io_latency_tracer_bpf *skel = NULL;
+    enum wire_format format = WIRE_FORMAT_BINARY;
+    unsigned int flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
     int stats_map_fd = -1;
+    int inflight_map_fd = -1;
     int err = 0;
+    int opt;
+    int realtime_mode = 0;
+    int rt_cpu = -1;
+    int rt_fifo = 0;
+    const char *compress_codec = NULL;
+    const char *ipc_path = NULL;
+    const char *spool_dir = NULL;
+    const char *replay_path = NULL;
+    const char *stats_socket = NULL;
+    int replay_timed = 0;
+
+    static const struct option long_opts[] = {
+        {"json", no_argument, NULL, 'j'},
+        {"ipc", required_argument, NULL, 'I'},
+        {"spool", required_argument, NULL, 'S'},
+        {"flush-interval", required_argument, NULL, 'f'},
+        {"compress", required_argument, NULL, 'z'},
+        {"realtime", no_argument, NULL, 'R'},
+        {"rt-cpu", required_argument, NULL, 'A'},
+        {"rt-fifo", required_argument, NULL, 'F'},
+        {"replay", required_argument, NULL, 'P'},
+        {"replay-timed", no_argument, NULL, 'T'},
+        {"stats-socket", required_argument, NULL, 'U'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "jh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'j':
+            format = WIRE_FORMAT_JSON;
+            break;
+        case 'I':
+            ipc_path = optarg;
+            break;
+        case 'S':
+            spool_dir = optarg;
+            break;
+        case 'f':
+            flush_interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'R':
+            realtime_mode = 1;
+            break;
+        case 'A':
+            rt_cpu = atoi(optarg);
+            if (rt_cpu < 0) {
+                fprintf(stderr, "ERROR: --rt-cpu must be a CPU number\n");
+                return 1;
+            }
+            break;
+        case 'F':
+            rt_fifo = atoi(optarg);
+            if (rt_fifo < 1 || rt_fifo > 99) {
+                fprintf(stderr, "ERROR: --rt-fifo must be 1-99\n");
+                return 1;
+            }
+            break;
+        case 'P':
+            replay_path = optarg;
+            break;
+        case 'T':
+            replay_timed = 1;
+            break;
+        case 'U':
+            stats_socket = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rt_cpu >= 0 || rt_fifo > 0) {
+        realtime_mode = 1;
+    }
+    if (realtime_mode && realtime_enter(rt_cpu, rt_fifo) != 0) {
+        return 1;
+    }
+
+    if (ipc_path) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --ipc carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_ring_create(&ipc, ipc_path, 0) != 0) {
+            return 1;
+        }
+        ipc_active = 1;
+    }
+
+    if (spool_dir) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --spool carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_active) {
+            fprintf(stderr, "ERROR: --spool and --ipc are mutually exclusive\n");
+            return 1;
+        }
+        if (spool_writer_open(&spool, spool_dir, 0, 0) != 0) {
+            return 1;
+        }
+        spool_active = 1;
+    }
 
-    (void)argc;
-    (void)argv;
+    // Set up batched output
+    if (wire_writer_init(&wire, STDOUT_FILENO, format, 0, flush_interval_ms) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+
+    // Self-instrumentation: histogram the map drain and expose it (with
+    // the wire writer's flush stalls) on the stats socket
+    hotpath_register(&drain_hist, "drain_stats");
+    if (stats_socket && hotpath_stats_listen(stats_socket) != 0) {
+        return 1;
+    }
 
     // Set up libbpf logging
+    // Replay mode: feed a recorded capture through the serialization
+    // path and report throughput; no BPF programs are loaded
+    if (replay_path) {
+        self_telemetry_init(&selftel, "io", -1, -1);
+
+        struct replay_stats rst;
+        err = replay_run(replay_path, replay_timed, replay_record_ns, replay_dispatch, &rst);
+
+        if (err == 0) {
+            replay_report(replay_path, &rst);
+        }
+        if (ipc_active) {
+            ipc_ring_close(&ipc);
+        }
+        if (spool_active) {
+            spool_writer_close(&spool);
+        }
+        hotpath_stats_close();
+        wire_writer_destroy(&wire);
+        return err != 0;
+    }
+
     libbpf_set_print(libbpf_print_fn);
 
     // Set up signal handlers
@@ -199,58 +641,35 @@ int main(int argc, char **argv)
 
     fprintf(stderr, "Loading eBPF program...\n");
 
-    // Open BPF object file
-    obj = bpf_object__open_file("io_latency_tracer.bpf.o", NULL);
-    if (libbpf_get_error(obj)) {
-        fprintf(stderr, "ERROR: failed to open BPF object file\n");
+    // Open and load the embedded BPF skeleton (no .bpf.o file on disk)
+    skel = io_latency_tracer_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "ERROR: failed to open BPF skeleton\n");
         return 1;
     }
 
-    // Load BPF object into kernel
-    err = bpf_object__load(obj);
+    err = io_latency_tracer_bpf__load(skel);
     if (err) {
-        fprintf(stderr, "ERROR: failed to load BPF object: %d\n", err);
+        fprintf(stderr, "ERROR: failed to load BPF skeleton: %d\n", err);
         goto cleanup;
     }
 
     fprintf(stderr, "BPF program loaded successfully\n");
 
-    // Find BPF programs
-    prog_issue = bpf_object__find_program_by_name(obj, "trace_block_rq_issue");
-    prog_complete = bpf_object__find_program_by_name(obj, "trace_block_rq_complete");
-
-    if (!prog_issue || !prog_complete) {
-        fprintf(stderr, "ERROR: failed to find BPF programs\n");
-        err = -1;
-        goto cleanup;
-    }
-
     // Attach BPF programs
-    link_issue = bpf_program__attach(prog_issue);
-    if (libbpf_get_error(link_issue)) {
-        fprintf(stderr, "ERROR: failed to attach block_rq_issue tracepoint\n");
-        link_issue = NULL;
-        err = -1;
-        goto cleanup;
-    }
-
-    link_complete = bpf_program__attach(prog_complete);
-    if (libbpf_get_error(link_complete)) {
-        fprintf(stderr, "ERROR: failed to attach block_rq_complete tracepoint\n");
-        link_complete = NULL;
-        err = -1;
+    err = io_latency_tracer_bpf__attach(skel);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to attach tracepoints: %d\n", err);
         goto cleanup;
     }
 
     fprintf(stderr, "BPF programs attached to tracepoints\n");
 
-    // Get stats map file descriptor
-    stats_map_fd = bpf_object__find_map_fd_by_name(obj, "io_stats_map");
-    if (stats_map_fd < 0) {
-        fprintf(stderr, "ERROR: failed to find stats map\n");
-        err = stats_map_fd;
-        goto cleanup;
-    }
+    // Get stats and gauge map file descriptors
+    stats_map_fd = bpf_map__fd(skel->maps.io_stats_map);
+    inflight_map_fd = bpf_map__fd(skel->maps.io_inflight_map);
+
+    self_telemetry_init(&selftel, "io_latency", -1, -1);
 
     fprintf(stderr, "Tracing block I/O latency... Press Ctrl+C to exit\n\n");
 
@@ -260,25 +679,35 @@ int main(int argc, char **argv)
 
         unsigned long long timestamp = time(NULL) * 1000000000ULL;
 
-        // Merge per-CPU stats
-        struct io_stats merged_stats;
-        merge_stats(stats_map_fd, &merged_stats);
-
-        // Print if we have any activity
-        if (merged_stats.read_count > 0 || merged_stats.write_count > 0) {
-            print_stats(&merged_stats, timestamp);
-        }
+        // Emit one record per device with activity this interval
+        selftel.events_consumed += drain_stats(stats_map_fd, inflight_map_fd, timestamp);
 
-        // Clear stats for next interval
-        clear_stats(stats_map_fd);
+        // Flush batched output once the deadline passes
+        wire_maybe_flush(&wire);
+        self_telemetry_maybe_emit(&selftel, &wire);
     }
 
     fprintf(stderr, "\nShutting down...\n");
 
 cleanup:
-    bpf_link__destroy(link_issue);
-    bpf_link__destroy(link_complete);
-    bpf_object__close(obj);
+    io_latency_tracer_bpf__destroy(skel);
+    self_telemetry_destroy(&selftel);
+    if (ipc_active) {
+        if (ipc.dropped > 0) {
+            fprintf(stderr, "WARNING: %lu records dropped on full IPC ring\n",
+                    (unsigned long)ipc.dropped);
+        }
+        ipc_ring_close(&ipc);
+    }
+    if (spool_active) {
+        if (spool.recycled > 0) {
+            fprintf(stderr, "WARNING: %lu spool segments recycled before being consumed\n",
+                    (unsigned long)spool.recycled);
+        }
+        spool_writer_close(&spool);
+    }
+    hotpath_stats_close();
+    wire_writer_destroy(&wire);
 
     return err != 0;
 }
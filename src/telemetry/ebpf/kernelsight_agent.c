@@ -0,0 +1,911 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Unified telemetry agent
+// Loads all four BPF objects in one process, registers every ring buffer
+// plus a timerfd for the scraper path in a single epoll loop, and
+// multiplexes all records onto one JSONL output stream. Replaces the
+// five-process setup (four loaders + scraper_daemon) at fleet scale;
+// the individual binaries remain available as debug tools.
+
+// Include generated syscall names - build will fail if not generated
+#include "../common/syscall_names.h"
+#include "../common/json_writer.h"
+#include "../common/self_telemetry.h"
+#include "../common/wire.h"
+// Generated BPF skeletons: each embeds its BPF object and exposes typed map access
+#include "io_latency_tracer.skel.h"
+#include "page_fault_tracer.skel.h"
+#include "sched_tracer.skel.h"
+#include "syscall_tracer.skel.h"
+#include "../sysfs/net_stats.h"
+#include "../sysfs/proc_scraper.h"
+#include "../sysfs/sysfs_scraper.h"
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TASK_COMM_LEN 16
+
+// I/O latency sketch geometry (must match io_latency_tracer.bpf.c):
+// 32 linear sub-buckets per power-of-two octave, i.e. DDSketch
+// gamma = 2^(1/32) (~1.022), bounding quantile relative error at ~1.6%
+#define IO_HIST_SUB_BITS 5
+#define IO_HIST_SUB (1 << IO_HIST_SUB_BITS)
+#define IO_HIST_MAX_EXP 22
+#define IO_HIST_SLOTS ((IO_HIST_MAX_EXP - IO_HIST_SUB_BITS + 1) * IO_HIST_SUB)
+
+// ============================================================================
+// Event structures (must match the BPF programs)
+// ============================================================================
+
+struct syscall_event {
+    unsigned long long timestamp;
+    unsigned int pid;
+    unsigned int tid;
+    unsigned int syscall_nr;
+    unsigned long long latency_ns;
+    long long ret_value;
+    unsigned long long arg0;
+    unsigned int cpu;
+    unsigned int uid;
+    unsigned char is_error;
+    char comm[TASK_COMM_LEN];
+};
+
+struct bucket_stats {
+    unsigned long long time_bucket;
+    unsigned int pid;
+    char comm[TASK_COMM_LEN];
+    unsigned long long context_switches;
+    unsigned long long voluntary_switches;
+    unsigned long long involuntary_switches;
+    unsigned long long wakeups;
+    unsigned long long cpu_time_ns;
+    unsigned long long total_timeslice_ns;
+    unsigned int timeslice_count;
+};
+
+struct page_fault_event {
+    unsigned long long timestamp;
+    unsigned int pid;
+    unsigned int tid;
+    unsigned long long address;
+    unsigned long long latency_ns;
+    unsigned int cpu;
+    unsigned char is_major;
+    unsigned char is_write;
+    unsigned char is_kernel;
+    unsigned char is_instruction;
+    unsigned int sample_ratio;
+    char comm[TASK_COMM_LEN];
+};
+
+struct hist {
+    unsigned int slots[IO_HIST_SLOTS];
+};
+
+struct io_stats {
+    struct hist read_hist;     // D2C (issue to complete)
+    struct hist write_hist;
+    struct hist read_q2c_hist; // Q2C (insert to complete, includes queueing)
+    struct hist write_q2c_hist;
+    unsigned long long read_count;
+    unsigned long long write_count;
+    unsigned long long read_bytes;
+    unsigned long long write_bytes;
+};
+
+static volatile sig_atomic_t exiting = 0;
+
+// Batched output writer for all multiplexed records
+static struct wire_writer wire;
+
+// One self-telemetry source per BPF event stream, plus one for the
+// I/O latency merge path (which has no ring buffer)
+static struct self_telemetry selftel_syscall;
+static struct self_telemetry selftel_sched;
+static struct self_telemetry selftel_pagefault;
+static struct self_telemetry selftel_io;
+
+static void sig_handler(int sig)
+{
+    exiting = 1;
+}
+
+// ============================================================================
+// Event emitters (same JSONL record shapes as the individual loaders)
+// ============================================================================
+
+static int handle_syscall_event(void *ctx, void *data, size_t data_sz)
+{
+    const struct syscall_event *e = data;
+    struct tm *tm;
+    time_t t;
+    char ts_str[64];
+    char line[512];
+    int len;
+
+    if (data_sz < sizeof(*e)) {
+        fprintf(stderr, "Error: syscall event too small\n");
+        return 0;
+    }
+
+    selftel_syscall.events_consumed++;
+
+    t = e->timestamp / 1000000000;
+    tm = localtime(&t);
+    strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
+
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", e->timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_u64(&jw, "pid", e->pid);
+    json_u64(&jw, "tid", e->tid);
+    json_u64(&jw, "cpu", e->cpu);
+    json_u64(&jw, "uid", e->uid);
+    json_u64(&jw, "syscall", e->syscall_nr);
+    json_str(&jw, "syscall_name", get_syscall_name(e->syscall_nr));
+    json_double(&jw, "latency_ms", e->latency_ns / 1000000.0, 3);
+    json_i64(&jw, "ret_value", e->ret_value);
+    json_bool(&jw, "is_error", e->is_error);
+    json_u64(&jw, "arg0", e->arg0);
+    json_str(&jw, "comm", e->comm);
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+
+    return 0;
+}
+
+static void emit_sched_bucket(const struct bucket_stats *e)
+{
+    char line[512];
+    double avg_timeslice_us = 0.0;
+    int len;
+
+    selftel_sched.events_consumed++;
+
+    if (e->timeslice_count > 0) {
+        avg_timeslice_us = (e->total_timeslice_ns / (double)e->timeslice_count) / 1000.0;
+    }
+
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "time_bucket", e->time_bucket);
+    json_u64(&jw, "pid", e->pid);
+    json_str(&jw, "comm", e->comm);
+    json_u64(&jw, "context_switches", e->context_switches);
+    json_u64(&jw, "voluntary_switches", e->voluntary_switches);
+    json_u64(&jw, "involuntary_switches", e->involuntary_switches);
+    json_u64(&jw, "wakeups", e->wakeups);
+    json_double(&jw, "cpu_time_ms", e->cpu_time_ns / 1000000.0, 3);
+    json_double(&jw, "avg_timeslice_us", avg_timeslice_us, 3);
+    json_str(&jw, "type", "sched");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+#define MAX_SCHED_BUCKETS 10240 // Must match the BPF map's max_entries
+
+// Merge one process's per-CPU buckets into a single record (comm and
+// time_bucket come from the first CPU that touched the entry)
+static void merge_sched_bucket(const struct bucket_stats *cpu_stats, unsigned int nr_cpus,
+                               unsigned int pid, struct bucket_stats *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+    merged->pid = pid;
+
+    for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+        if (merged->comm[0] == 0 && cpu_stats[cpu].comm[0] != 0) {
+            memcpy(merged->comm, cpu_stats[cpu].comm, TASK_COMM_LEN);
+            merged->time_bucket = cpu_stats[cpu].time_bucket;
+        }
+        merged->context_switches += cpu_stats[cpu].context_switches;
+        merged->voluntary_switches += cpu_stats[cpu].voluntary_switches;
+        merged->involuntary_switches += cpu_stats[cpu].involuntary_switches;
+        merged->wakeups += cpu_stats[cpu].wakeups;
+        merged->cpu_time_ns += cpu_stats[cpu].cpu_time_ns;
+        merged->total_timeslice_ns += cpu_stats[cpu].total_timeslice_ns;
+        merged->timeslice_count += cpu_stats[cpu].timeslice_count;
+    }
+}
+
+// Drain the sched tracer's per-CPU bucket map (same merge the standalone
+// sched_tracer loader performs each second)
+static void drain_sched_buckets(int map_fd)
+{
+    unsigned int nr_cpus = libbpf_num_possible_cpus();
+    struct bucket_stats *cpu_stats;
+    unsigned int *keys;
+    int key_count = 0;
+
+    cpu_stats = calloc(nr_cpus, sizeof(struct bucket_stats));
+    keys = calloc(MAX_SCHED_BUCKETS, sizeof(unsigned int));
+    if (!cpu_stats || !keys) {
+        free(cpu_stats);
+        free(keys);
+        return;
+    }
+
+    // Collect keys first: deleting while iterating restarts the walk
+    unsigned int key, next_key;
+    unsigned int *cur = NULL;
+    while (key_count < MAX_SCHED_BUCKETS && bpf_map_get_next_key(map_fd, cur, &next_key) == 0) {
+        keys[key_count++] = next_key;
+        key = next_key;
+        cur = &key;
+    }
+
+    for (int i = 0; i < key_count; i++) {
+        if (bpf_map_lookup_elem(map_fd, &keys[i], cpu_stats) != 0) {
+            continue;
+        }
+
+        struct bucket_stats merged;
+        merge_sched_bucket(cpu_stats, nr_cpus, keys[i], &merged);
+
+        if (merged.context_switches > 0 || merged.wakeups > 0) {
+            emit_sched_bucket(&merged);
+        }
+
+        bpf_map_delete_elem(map_fd, &keys[i]);
+    }
+
+    free(cpu_stats);
+    free(keys);
+}
+
+static int handle_pagefault_event(void *ctx, void *data, size_t data_sz)
+{
+    const struct page_fault_event *e = data;
+    struct tm *tm;
+    time_t t;
+    char ts_str[64];
+    char line[512];
+    int len;
+
+    if (data_sz < sizeof(*e)) {
+        fprintf(stderr, "Error: page fault event too small\n");
+        return 0;
+    }
+
+    selftel_pagefault.events_consumed++;
+
+    t = e->timestamp / 1000000000;
+    tm = localtime(&t);
+    strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
+
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", e->timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_u64(&jw, "pid", e->pid);
+    json_u64(&jw, "tid", e->tid);
+    json_str(&jw, "comm", e->comm);
+    json_hex(&jw, "address", e->address);
+    json_u64(&jw, "latency_ns", e->latency_ns);
+    json_double(&jw, "latency_us", e->latency_ns / 1000.0, 3);
+    json_u64(&jw, "cpu", e->cpu);
+    json_bool(&jw, "is_major", e->is_major);
+    json_bool(&jw, "is_write", e->is_write);
+    json_bool(&jw, "is_kernel", e->is_kernel);
+    json_bool(&jw, "is_instruction", e->is_instruction);
+    json_u64(&jw, "sample_ratio", e->sample_ratio);
+    json_str(&jw, "type", "pagefault");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// I/O latency stats (merged from the per-CPU map on each timer tick)
+// ============================================================================
+
+// Lower bound in microseconds of a sketch slot: inverse of the BPF-side
+// io_hist_slot() mapping. slot_lower_bound(i + 1) is bucket i's upper edge.
+static double slot_lower_bound(int slot)
+{
+    if (slot < IO_HIST_SUB) {
+        return (double)slot;
+    }
+
+    int exp = (slot >> IO_HIST_SUB_BITS) + IO_HIST_SUB_BITS - 1;
+    int sub = slot & (IO_HIST_SUB - 1);
+
+    return (double)((unsigned long long)(IO_HIST_SUB + sub) << (exp - IO_HIST_SUB_BITS));
+}
+
+// Calculate percentile from histogram (log-linear sketch, microseconds)
+static double calculate_percentile(const struct hist *h, unsigned long long total,
+                                   double percentile)
+{
+    if (total == 0) {
+        return 0.0;
+    }
+
+    unsigned long long target = (unsigned long long)(total * percentile / 100.0);
+    unsigned long long cumulative = 0;
+
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
+        cumulative += h->slots[i];
+
+        if (cumulative >= target) {
+            return (slot_lower_bound(i) + slot_lower_bound(i + 1)) / 2.0;
+        }
+    }
+
+    return (double)(1ULL << IO_HIST_MAX_EXP);
+}
+
+static double get_max_latency(const struct hist *h)
+{
+    for (int i = IO_HIST_SLOTS - 1; i >= 0; i--) {
+        if (h->slots[i] > 0) {
+            return slot_lower_bound(i + 1);
+        }
+    }
+    return 0.0;
+}
+
+#define MAX_IO_DEVICES 64
+
+// Resolve a kernel dev_t (MKDEV encoding: major << 20 | minor) to a device
+// name via the /sys/dev/block symlink, caching results across intervals
+static const char *resolve_io_device_name(unsigned int dev)
+{
+    static struct {
+        unsigned int dev;
+        char name[32];
+    } cache[MAX_IO_DEVICES];
+    static int cache_count = 0;
+
+    for (int i = 0; i < cache_count; i++) {
+        if (cache[i].dev == dev) {
+            return cache[i].name;
+        }
+    }
+
+    unsigned int major = dev >> 20;
+    unsigned int minor = dev & 0xFFFFF;
+    char path[64];
+    char target[256];
+    char name[32];
+
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u", major, minor);
+    ssize_t link_len = readlink(path, target, sizeof(target) - 1);
+    if (link_len > 0) {
+        target[link_len] = '\0';
+        const char *base = strrchr(target, '/');
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : target);
+    } else {
+        // No sysfs entry (device gone?) - fall back to major:minor
+        snprintf(name, sizeof(name), "%u:%u", major, minor);
+    }
+
+    if (cache_count < MAX_IO_DEVICES) {
+        cache[cache_count].dev = dev;
+        snprintf(cache[cache_count].name, sizeof(cache[cache_count].name), "%s", name);
+        return cache[cache_count++].name;
+    }
+
+    static char overflow[32];
+    snprintf(overflow, sizeof(overflow), "%s", name);
+    return overflow;
+}
+
+// Merge one device's per-CPU stats into a single aggregate
+static void merge_io_cpu_stats(const struct io_stats *cpu_stats, unsigned int nr_cpus,
+                               struct io_stats *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+
+    for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+        merged->read_count += cpu_stats[cpu].read_count;
+        merged->write_count += cpu_stats[cpu].write_count;
+        merged->read_bytes += cpu_stats[cpu].read_bytes;
+        merged->write_bytes += cpu_stats[cpu].write_bytes;
+
+        for (int i = 0; i < IO_HIST_SLOTS; i++) {
+            merged->read_hist.slots[i] += cpu_stats[cpu].read_hist.slots[i];
+            merged->write_hist.slots[i] += cpu_stats[cpu].write_hist.slots[i];
+            merged->read_q2c_hist.slots[i] += cpu_stats[cpu].read_q2c_hist.slots[i];
+            merged->write_q2c_hist.slots[i] += cpu_stats[cpu].write_q2c_hist.slots[i];
+        }
+    }
+}
+
+// Sum a histogram's buckets (the Q2C hists carry no kernel-side counter)
+static unsigned long long io_hist_total(const struct hist *h)
+{
+    unsigned long long total = 0;
+    for (int i = 0; i < IO_HIST_SLOTS; i++) {
+        total += h->slots[i];
+    }
+    return total;
+}
+
+static void emit_io_stats(unsigned int dev, const struct io_stats *stats,
+                          long long queue_depth, unsigned long long timestamp)
+{
+    struct tm *tm;
+    time_t t;
+    char ts_str[64];
+    char line[768];
+    int len;
+
+    double read_p50 = 0, read_p95 = 0, read_p99 = 0, read_max = 0;
+    double write_p50 = 0, write_p95 = 0, write_p99 = 0, write_max = 0;
+    double read_q2c_p50 = 0, read_q2c_p99 = 0;
+    double write_q2c_p50 = 0, write_q2c_p99 = 0;
+    unsigned long long read_q2c_total = io_hist_total(&stats->read_q2c_hist);
+    unsigned long long write_q2c_total = io_hist_total(&stats->write_q2c_hist);
+
+    if (stats->read_count > 0) {
+        read_p50 = calculate_percentile(&stats->read_hist, stats->read_count, 50.0);
+        read_p95 = calculate_percentile(&stats->read_hist, stats->read_count, 95.0);
+        read_p99 = calculate_percentile(&stats->read_hist, stats->read_count, 99.0);
+        read_max = get_max_latency(&stats->read_hist);
+    }
+
+    if (stats->write_count > 0) {
+        write_p50 = calculate_percentile(&stats->write_hist, stats->write_count, 50.0);
+        write_p95 = calculate_percentile(&stats->write_hist, stats->write_count, 95.0);
+        write_p99 = calculate_percentile(&stats->write_hist, stats->write_count, 99.0);
+        write_max = get_max_latency(&stats->write_hist);
+    }
+
+    if (read_q2c_total > 0) {
+        read_q2c_p50 = calculate_percentile(&stats->read_q2c_hist, read_q2c_total, 50.0);
+        read_q2c_p99 = calculate_percentile(&stats->read_q2c_hist, read_q2c_total, 99.0);
+    }
+
+    if (write_q2c_total > 0) {
+        write_q2c_p50 = calculate_percentile(&stats->write_q2c_hist, write_q2c_total, 50.0);
+        write_q2c_p99 = calculate_percentile(&stats->write_q2c_hist, write_q2c_total, 99.0);
+    }
+
+    t = timestamp / 1000000000;
+    tm = localtime(&t);
+    strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
+
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_str(&jw, "device", resolve_io_device_name(dev));
+    json_u64(&jw, "interval_seconds", 1);
+    json_u64(&jw, "read_count", stats->read_count);
+    json_u64(&jw, "read_bytes", stats->read_bytes);
+    json_double(&jw, "read_p50_us", read_p50, 2);
+    json_double(&jw, "read_p95_us", read_p95, 2);
+    json_double(&jw, "read_p99_us", read_p99, 2);
+    json_double(&jw, "read_max_us", read_max, 2);
+    json_u64(&jw, "write_count", stats->write_count);
+    json_u64(&jw, "write_bytes", stats->write_bytes);
+    json_double(&jw, "write_p50_us", write_p50, 2);
+    json_double(&jw, "write_p95_us", write_p95, 2);
+    json_double(&jw, "write_p99_us", write_p99, 2);
+    json_double(&jw, "write_max_us", write_max, 2);
+    json_double(&jw, "read_q2c_p50_us", read_q2c_p50, 2);
+    json_double(&jw, "read_q2c_p99_us", read_q2c_p99, 2);
+    json_double(&jw, "write_q2c_p50_us", write_q2c_p50, 2);
+    json_double(&jw, "write_q2c_p99_us", write_q2c_p99, 2);
+    json_u64(&jw, "queue_depth", queue_depth < 0 ? 0 : (unsigned long long)queue_depth);
+    json_str(&jw, "type", "io");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+// Walk the per-device map, emit one record per active device, then delete
+// the drained entries so each interval starts fresh. Returns the number of
+// records emitted.
+static int drain_io_stats(int stats_map_fd, int inflight_map_fd, unsigned long long timestamp)
+{
+    unsigned int nr_cpus = libbpf_num_possible_cpus();
+    unsigned int keys[MAX_IO_DEVICES];
+    int key_count = 0;
+    int emitted = 0;
+
+    struct io_stats *cpu_stats = calloc(nr_cpus, sizeof(struct io_stats));
+    if (!cpu_stats) {
+        return 0;
+    }
+
+    // Collect keys first: deleting while iterating restarts the walk
+    unsigned int key, next_key;
+    unsigned int *cur = NULL;
+    while (key_count < MAX_IO_DEVICES && bpf_map_get_next_key(stats_map_fd, cur, &next_key) == 0) {
+        keys[key_count++] = next_key;
+        key = next_key;
+        cur = &key;
+    }
+
+    for (int i = 0; i < key_count; i++) {
+        if (bpf_map_lookup_elem(stats_map_fd, &keys[i], cpu_stats) != 0) {
+            continue;
+        }
+
+        struct io_stats merged;
+        merge_io_cpu_stats(cpu_stats, nr_cpus, &merged);
+
+        // Read (never drain) the instantaneous queue-depth gauge
+        long long queue_depth = 0;
+        if (inflight_map_fd >= 0) {
+            bpf_map_lookup_elem(inflight_map_fd, &keys[i], &queue_depth);
+        }
+
+        if (merged.read_count > 0 || merged.write_count > 0) {
+            emit_io_stats(keys[i], &merged, queue_depth, timestamp);
+            emitted++;
+        }
+
+        bpf_map_delete_elem(stats_map_fd, &keys[i]);
+    }
+
+    free(cpu_stats);
+    return emitted;
+}
+
+// ============================================================================
+// Scraper path (same records as scraper_daemon, on the shared timer tick)
+// ============================================================================
+
+static uint64_t get_timestamp_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Cached scrape state: built once on the first tick, refreshed only when
+// a hotplug event invalidates the block device inventory
+static struct block_device_cache scrape_blk_cache;
+static struct net_dev_cache scrape_net_cache;
+static struct proc_scrape_cache scrape_proc_cache;
+static struct tcp_scrape_cache scrape_tcp_cache;
+static int scrape_proc_cache_ok;
+static int scrape_tcp_cache_ok;
+static int scrape_cache_ready;
+
+static void scrape_tick(void)
+{
+    struct meminfo_metrics meminfo;
+    struct loadavg_metrics loadavg;
+    uint64_t timestamp = get_timestamp_ns();
+
+    if (!scrape_cache_ready) {
+        if (block_device_cache_init(&scrape_blk_cache) != 0) {
+            fprintf(stderr, "WARNING: failed to build block device inventory\n");
+        }
+        scrape_proc_cache_ok = (proc_scrape_cache_init(&scrape_proc_cache) == 0);
+        scrape_tcp_cache_ok = (tcp_scrape_cache_init(&scrape_tcp_cache) == 0);
+        scrape_cache_ready = 1;
+    }
+
+    if (scrape_proc_cache_ok ? read_proc_meminfo_cached(&scrape_proc_cache, &meminfo) == 0
+                             : read_proc_meminfo(&meminfo) == 0) {
+        print_meminfo_json(&meminfo, timestamp);
+    }
+
+    if (scrape_proc_cache_ok ? read_proc_loadavg_cached(&scrape_proc_cache, &loadavg) == 0
+                             : read_proc_loadavg(&loadavg) == 0) {
+        print_loadavg_json(&loadavg, timestamp);
+    }
+
+    block_device_cache_refresh(&scrape_blk_cache);
+    for (int i = 0; i < scrape_blk_cache.count; i++) {
+        struct block_device_entry *entry = &scrape_blk_cache.entries[i];
+        if (read_block_stats_fd(entry->stat_fd, &entry->stats) == 0) {
+            print_block_stats_json(entry->name, &entry->stats, timestamp);
+        }
+    }
+
+    if (read_net_dev_cached(&scrape_net_cache) == 0) {
+        for (int i = 0; i < scrape_net_cache.count; i++) {
+            print_interface_stats_json(&scrape_net_cache.interfaces[i], timestamp);
+        }
+    }
+
+    struct tcp_stats tcp_stats;
+    if (scrape_tcp_cache_ok ? read_tcp_stats_cached(&scrape_tcp_cache, &tcp_stats) == 0
+                            : read_tcp_stats(&tcp_stats) == 0) {
+        print_tcp_stats_json(&tcp_stats, timestamp);
+    }
+
+    struct tcp_retransmit_stats retrans_stats;
+    if (scrape_tcp_cache_ok ? read_tcp_retransmits_cached(&scrape_tcp_cache, &retrans_stats) == 0
+                            : read_tcp_retransmits(&retrans_stats) == 0) {
+        print_tcp_retransmit_json(&retrans_stats, timestamp);
+    }
+}
+
+static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
+{
+    if (level >= LIBBPF_INFO) {
+        return vfprintf(stderr, format, args);
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --flush-interval MS    Max output buffering delay (default %d)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each flush\n"
+            "                         ends a frame so consumers can decode incrementally\n",
+            prog, WIRE_DEFAULT_FLUSH_MS);
+}
+
+int main(int argc, char **argv)
+{
+    struct syscall_tracer_bpf *syscall_skel = NULL;
+    struct sched_tracer_bpf *sched_skel = NULL;
+    struct page_fault_tracer_bpf *pagefault_skel = NULL;
+    struct io_latency_tracer_bpf *io_skel = NULL;
+    struct ring_buffer *rb = NULL;
+    unsigned int flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
+    int epoll_fd = -1, timer_fd = -1;
+    int io_stats_fd = -1;
+    int io_inflight_fd = -1;
+    int err = 0;
+    int opt;
+    const char *compress_codec = NULL;
+
+    static const struct option long_opts[] = {
+        {"flush-interval", required_argument, NULL, 'f'},
+        {"compress", required_argument, NULL, 'z'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'f':
+            flush_interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The agent multiplexes every source onto one JSONL stream, which is
+    // what the ingestion daemon consumes; per-loader binary framing stays
+    // with the individual debug binaries.
+    if (wire_writer_init(&wire, STDOUT_FILENO, WIRE_FORMAT_JSON, 0, flush_interval_ms) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+    // Scraper-path records share the writer's batching and compression
+    wire_set_line_sink(&wire);
+
+    libbpf_set_print(libbpf_print_fn);
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    fprintf(stderr, "Loading all eBPF programs...\n");
+
+    // Open, load and attach each embedded skeleton
+    syscall_skel = syscall_tracer_bpf__open();
+    sched_skel = sched_tracer_bpf__open();
+    pagefault_skel = page_fault_tracer_bpf__open();
+    io_skel = io_latency_tracer_bpf__open();
+    if (!syscall_skel || !sched_skel || !pagefault_skel || !io_skel) {
+        fprintf(stderr, "ERROR: failed to open BPF skeletons\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    err = syscall_tracer_bpf__load(syscall_skel);
+    if (!err) {
+        err = sched_tracer_bpf__load(sched_skel);
+    }
+    if (!err) {
+        err = page_fault_tracer_bpf__load(pagefault_skel);
+    }
+    if (!err) {
+        err = io_latency_tracer_bpf__load(io_skel);
+    }
+    if (err) {
+        fprintf(stderr, "ERROR: failed to load BPF skeletons: %d\n", err);
+        goto cleanup;
+    }
+
+    err = syscall_tracer_bpf__attach(syscall_skel);
+    if (!err) {
+        err = sched_tracer_bpf__attach(sched_skel);
+    }
+    if (!err) {
+        err = page_fault_tracer_bpf__attach(pagefault_skel);
+    }
+    if (!err) {
+        err = io_latency_tracer_bpf__attach(io_skel);
+    }
+    if (err) {
+        fprintf(stderr, "ERROR: failed to attach BPF programs: %d\n", err);
+        goto cleanup;
+    }
+
+    fprintf(stderr, "All BPF programs loaded and attached\n");
+
+    // Register every event ring buffer in one libbpf ring_buffer (shared epoll)
+    int syscall_rb_fd = bpf_map__fd(syscall_skel->maps.events);
+    int sched_buckets_fd = bpf_map__fd(sched_skel->maps.bucket_aggregates);
+    int pagefault_rb_fd = bpf_map__fd(pagefault_skel->maps.events);
+    io_stats_fd = bpf_map__fd(io_skel->maps.io_stats_map);
+    io_inflight_fd = bpf_map__fd(io_skel->maps.io_inflight_map);
+
+    // Track kernel-side drops and ring utilization per source
+    self_telemetry_init(&selftel_syscall, "syscall",
+                        bpf_map__fd(syscall_skel->maps.prog_stats_map), syscall_rb_fd);
+    self_telemetry_init(&selftel_sched, "sched", bpf_map__fd(sched_skel->maps.prog_stats_map),
+                        -1);
+    self_telemetry_init(&selftel_pagefault, "pagefault",
+                        bpf_map__fd(pagefault_skel->maps.prog_stats_map), pagefault_rb_fd);
+    self_telemetry_init(&selftel_io, "io_latency", -1, -1);
+
+    rb = ring_buffer__new(syscall_rb_fd, handle_syscall_event, NULL, NULL);
+    if (!rb) {
+        fprintf(stderr, "ERROR: failed to create ring buffer\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    err = ring_buffer__add(rb, pagefault_rb_fd, handle_pagefault_event, NULL);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to register ring buffers: %d\n", err);
+        goto cleanup;
+    }
+
+    // Single epoll instance: all ring buffers plus the 1-second scrape timer
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        fprintf(stderr, "ERROR: failed to create epoll instance\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (timer_fd < 0) {
+        fprintf(stderr, "ERROR: failed to create timerfd\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    struct itimerspec timer_spec = {
+        .it_interval = {.tv_sec = 1},
+        .it_value = {.tv_sec = 1},
+    };
+    timerfd_settime(timer_fd, 0, &timer_spec, NULL);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = ring_buffer__epoll_fd(rb);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) < 0) {
+        fprintf(stderr, "ERROR: failed to register ring buffer fd\n");
+        err = -1;
+        goto cleanup;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+        fprintf(stderr, "ERROR: failed to register timer fd\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    fprintf(stderr, "Unified agent running (4 tracers + scraper)... Press Ctrl+C to exit\n\n");
+
+    while (!exiting) {
+        struct epoll_event events[8];
+        int n = epoll_wait(epoll_fd, events, 8, 1000);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "ERROR: epoll_wait failed\n");
+            err = -1;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == timer_fd) {
+                // Drain the timer, then run the per-second work: scrapes
+                // plus I/O latency stats merge
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+                    continue;
+                }
+
+                scrape_tick();
+
+                // Merge and emit the sched tracer's per-CPU buckets
+                drain_sched_buckets(sched_buckets_fd);
+
+                // One record per device with activity this interval
+                selftel_io.events_consumed +=
+                    drain_io_stats(io_stats_fd, io_inflight_fd, get_timestamp_ns());
+            } else {
+                // Ring buffer data available: consume without a poll timeout
+                ring_buffer__consume(rb);
+            }
+        }
+
+        // Flush batched output once the deadline passes
+        wire_maybe_flush(&wire);
+        self_telemetry_maybe_emit(&selftel_syscall, &wire);
+        self_telemetry_maybe_emit(&selftel_sched, &wire);
+        self_telemetry_maybe_emit(&selftel_pagefault, &wire);
+        self_telemetry_maybe_emit(&selftel_io, &wire);
+    }
+
+    fprintf(stderr, "\nShutting down...\n");
+
+cleanup:
+    if (timer_fd >= 0) {
+        close(timer_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+    ring_buffer__free(rb);
+    self_telemetry_destroy(&selftel_syscall);
+    self_telemetry_destroy(&selftel_sched);
+    self_telemetry_destroy(&selftel_pagefault);
+    self_telemetry_destroy(&selftel_io);
+    if (scrape_cache_ready) {
+        block_device_cache_destroy(&scrape_blk_cache);
+        net_dev_cache_destroy(&scrape_net_cache);
+        if (scrape_proc_cache_ok) {
+            proc_scrape_cache_destroy(&scrape_proc_cache);
+        }
+        if (scrape_tcp_cache_ok) {
+            tcp_scrape_cache_destroy(&scrape_tcp_cache);
+        }
+    }
+    syscall_tracer_bpf__destroy(syscall_skel);
+    sched_tracer_bpf__destroy(sched_skel);
+    page_fault_tracer_bpf__destroy(pagefault_skel);
+    io_latency_tracer_bpf__destroy(io_skel);
+    wire_writer_destroy(&wire);
+
+    return err != 0;
+}
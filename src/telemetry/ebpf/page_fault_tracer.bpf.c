@@ -16,6 +16,18 @@
 
 #define TASK_COMM_LEN 16
 
+// Adaptive sampling for minor faults. Major faults are always reported at
+// full fidelity; minor faults are sampled 1-in-N where N doubles whenever
+// the per-CPU minor fault rate exceeds the configured budget and halves
+// when it falls back under it. Each emitted event carries the effective
+// ratio so the pipeline can rescale counts.
+#define SAMPLE_WINDOW_NS 1000000000ULL // Rate adaptation window (1 second)
+#define DEFAULT_MINOR_BUDGET 5000      // Minor events per CPU per second
+#define MAX_SAMPLE_SHIFT 16            // Shift stays below this, capping N at 1 << 15
+
+// Config map slots
+#define CONFIG_MINOR_BUDGET 0 // Per-CPU minor fault budget (0 = default)
+
 // VM fault return flags (from include/linux/mm.h)
 #define VM_FAULT_OOM 0x0001
 #define VM_FAULT_SIGBUS 0x0002
@@ -37,6 +49,7 @@ struct page_fault_event {
     __u8 is_write;            // 1 if write fault
     __u8 is_kernel;           // 1 if kernel-mode fault
     __u8 is_instruction;      // 1 if instruction fetch fault
+    __u32 sample_ratio;       // 1-in-N sampling ratio this event represents
     char comm[TASK_COMM_LEN]; // Process name
 };
 
@@ -67,6 +80,98 @@ struct {
     __uint(max_entries, 256 * 1024); // 256KB ring buffer
 } events SEC(".maps");
 
+// Config map: slot 0 holds the per-CPU minor fault budget
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u32);
+} config SEC(".maps");
+
+// Per-CPU adaptive sampling state for minor faults
+struct sample_state {
+    __u64 window_start; // Start of the current adaptation window
+    __u64 window_seen;  // Minor faults observed this window
+    __u32 shift;        // Current ratio: N = 1 << shift
+    __u32 counter;      // Running counter for the 1-in-N decision
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct sample_state);
+} sample_state_map SEC(".maps");
+
+// Decide whether to emit this minor fault. Returns 0 to skip, otherwise the
+// effective 1-in-N ratio the emitted event represents. Runs per-CPU, so the
+// state updates need no atomics.
+static __always_inline __u32 minor_sample_ratio(void)
+{
+    __u32 key = 0;
+    struct sample_state *st = bpf_map_lookup_elem(&sample_state_map, &key);
+    if (!st) {
+        return 1; // No state: fail open at full fidelity
+    }
+
+    __u64 now = bpf_ktime_get_ns();
+    if (now - st->window_start > SAMPLE_WINDOW_NS) {
+        __u32 budget = DEFAULT_MINOR_BUDGET;
+        __u32 *configured = bpf_map_lookup_elem(&config, &key);
+        if (configured && *configured > 0) {
+            budget = *configured;
+        }
+
+        // Back off when the emitted estimate exceeded the budget, recover
+        // one step when the previous ratio would have stayed under it
+        __u32 shift = st->shift & (MAX_SAMPLE_SHIFT - 1);
+        if ((st->window_seen >> shift) > budget && shift < MAX_SAMPLE_SHIFT - 1) {
+            shift++;
+        } else if (shift > 0 && (st->window_seen >> (shift - 1)) <= budget) {
+            shift--;
+        }
+        st->shift = shift;
+        st->window_start = now;
+        st->window_seen = 0;
+    }
+
+    st->window_seen++;
+    st->counter++;
+
+    __u32 shift = st->shift & (MAX_SAMPLE_SHIFT - 1);
+    if (st->counter & ((1U << shift) - 1)) {
+        return 0;
+    }
+    return 1U << shift;
+}
+
+// Self-telemetry counters (per-CPU; merged and emitted by the loader)
+struct prog_stats {
+    __u64 events_submitted; // Successful ring buffer submissions
+    __u64 ringbuf_drops;    // Failed bpf_ringbuf_reserve() calls
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct prog_stats);
+} prog_stats_map SEC(".maps");
+
+// Count one submission or one drop (per-CPU, so plain increments suffice)
+static __always_inline void count_event(int dropped)
+{
+    __u32 key = 0;
+    struct prog_stats *stats = bpf_map_lookup_elem(&prog_stats_map, &key);
+    if (stats) {
+        if (dropped) {
+            stats->ringbuf_drops++;
+        } else {
+            stats->events_submitted++;
+        }
+    }
+}
+
 // Kprobe entry handler for handle_mm_fault()
 // Function signature: vm_fault_t handle_mm_fault(struct vm_area_struct *vma,
 //                                                 unsigned long address,
@@ -119,9 +224,21 @@ int BPF_KRETPROBE(trace_mm_fault_exit, vm_fault_t retval)
     __u64 now = bpf_ktime_get_ns();
     __u64 latency_ns = now - entry->timestamp;
 
+    // Major faults are always reported; minor faults go through the
+    // adaptive sampler before touching the ring buffer
+    __u8 is_major = (retval & VM_FAULT_MAJOR) ? 1 : 0;
+    __u32 sample_ratio = 1;
+    if (!is_major) {
+        sample_ratio = minor_sample_ratio();
+        if (sample_ratio == 0) {
+            goto cleanup; // Sampled out
+        }
+    }
+
     // Reserve space in ring buffer
     struct page_fault_event *event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
     if (!event) {
+        count_event(1); // Ring full: the event is lost, make that visible
         goto cleanup;
     }
 
@@ -132,14 +249,16 @@ int BPF_KRETPROBE(trace_mm_fault_exit, vm_fault_t retval)
     event->address = entry->address;
     event->latency_ns = latency_ns;
     event->cpu = entry->cpu;
-    event->is_major = (retval & VM_FAULT_MAJOR) ? 1 : 0;
+    event->is_major = is_major;
     event->is_write = entry->is_write;
     event->is_kernel = entry->is_kernel;
     event->is_instruction = 0; // Not available from handle_mm_fault context
+    event->sample_ratio = sample_ratio;
     __builtin_memcpy(event->comm, entry->comm, TASK_COMM_LEN);
 
     // Submit event to userspace
     bpf_ringbuf_submit(event, 0);
+    count_event(0);
 
 cleanup:
     // Clean up entry from map
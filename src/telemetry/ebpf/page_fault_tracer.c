@@ -4,13 +4,26 @@
 // Userspace loader for page fault tracer
 // Uses libbpf to load eBPF program and output events as JSON
 
+#include "../common/self_telemetry.h"
+#include "../common/ipc_ring.h"
+#include "../common/hotpath.h"
+#include "../common/realtime.h"
+#include "../common/replay.h"
+#include "../common/spool.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+// Generated BPF skeleton: embeds the BPF object and provides typed map access
+#include "page_fault_tracer.skel.h"
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 #include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -26,28 +39,69 @@ struct page_fault_event {
     unsigned char is_write;
     unsigned char is_kernel;
     unsigned char is_instruction;
+    unsigned int sample_ratio;
     char comm[16];
 };
 
 static volatile sig_atomic_t exiting = 0;
 
+// Batched output writer shared by the JSON and binary emit paths
+static struct wire_writer wire;
+
+// Shared-memory ring transport (--ipc); NULL path means stdout only
+static struct ipc_ring ipc;
+static int ipc_active;
+
+// Store-and-forward segment spool (--spool); survives consumer restarts
+static struct spool_writer spool;
+static int spool_active;
+
+// Route one binary record to the spool or shared-memory ring when active,
+// otherwise to the batched stdout writer
+static void emit_record(uint8_t type, const void *payload, uint32_t len)
+{
+    if (spool_active) {
+        spool_write_record(&spool, type, payload, len);
+    } else if (ipc_active) {
+        ipc_ring_write(&ipc, type, payload, len);
+    } else {
+        wire_write_record(&wire, type, payload, len);
+    }
+}
+
+// Drop accounting and loader health, emitted on the same stream
+static struct self_telemetry selftel;
+
+// Cycle histogram for the ring buffer callback (--stats-socket / USDT)
+static struct hotpath_hist handle_event_hist;
+
+// In-process SPSC queue between the ring buffer consumer (main thread)
+// and the serializer thread. Serializing inside the ring buffer callback
+// means a stalled stdout consumer blocks ring_buffer__poll() and the
+// kernel ring overflows; this queue absorbs transient output stalls in
+// cheap userspace memory instead.
+#define EVENT_QUEUE_SIZE (8 * 1024 * 1024)
+static struct ipc_ring event_queue;
+static volatile int serializer_stop;
+
 static void sig_handler(int sig)
 {
     exiting = 1;
 }
 
-// Callback function for ring buffer events
-static int handle_event(void *ctx, void *data, size_t data_sz)
+// Format and write one kernel event (serializer thread only)
+static void serialize_event(const struct page_fault_event *e)
 {
-    const struct page_fault_event *e = data;
     struct tm *tm;
     time_t t;
     char ts_str[64];
-    double latency_us;
+    char line[512];
+    int len;
 
-    if (data_sz < sizeof(*e)) {
-        fprintf(stderr, "Error: event too small\n");
-        return 0;
+    // Binary mode: forward the kernel event verbatim as one frame
+    if (wire.format == WIRE_FORMAT_BINARY) {
+        emit_record(WIRE_REC_PAGEFAULT, e, sizeof(*e));
+        return;
     }
 
     // Convert timestamp to human-readable format
@@ -55,21 +109,104 @@ static int handle_event(void *ctx, void *data, size_t data_sz)
     tm = localtime(&t);
     strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
 
-    // Convert latency to microseconds
-    latency_us = e->latency_ns / 1000.0;
+    // Serialize as single-line JSON (JSONL format for streaming)
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", e->timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_u64(&jw, "pid", e->pid);
+    json_u64(&jw, "tid", e->tid);
+    json_str(&jw, "comm", e->comm);
+    json_hex(&jw, "address", e->address);
+    json_u64(&jw, "latency_ns", e->latency_ns);
+    json_double(&jw, "latency_us", e->latency_ns / 1000.0, 3);
+    json_u64(&jw, "cpu", e->cpu);
+    json_bool(&jw, "is_major", e->is_major);
+    json_bool(&jw, "is_write", e->is_write);
+    json_bool(&jw, "is_kernel", e->is_kernel);
+    json_bool(&jw, "is_instruction", e->is_instruction);
+    json_u64(&jw, "sample_ratio", e->sample_ratio);
+    json_str(&jw, "type", "pagefault");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+// Callback function for ring buffer events: only copies the event into
+// the userspace queue, so the poll loop never waits on output
+static int handle_event(void *ctx, void *data, size_t data_sz)
+{
+    uint64_t start = hotpath_cycles();
 
-    // Output as single-line JSON (JSONL format for streaming)
-    printf("{\"timestamp\":%llu,\"time_str\":\"%s\",\"pid\":%u,\"tid\":%u,\"comm\":\"%s\","
-           "\"address\":\"0x%llx\",\"latency_ns\":%llu,\"latency_us\":%.3f,\"cpu\":%u,\"is_major\":"
-           "%s,\"is_write\":%s,\"is_kernel\":%s,\"is_instruction\":%s,\"type\":\"pagefault\"}\n",
-           e->timestamp, ts_str, e->pid, e->tid, e->comm, e->address, e->latency_ns, latency_us,
-           e->cpu, e->is_major ? "true" : "false", e->is_write ? "true" : "false",
-           e->is_kernel ? "true" : "false", e->is_instruction ? "true" : "false");
-    fflush(stdout);
+    if (data_sz < sizeof(struct page_fault_event)) {
+        fprintf(stderr, "Error: event too small\n");
+        return 0;
+    }
 
+    selftel.events_consumed++;
+    ipc_ring_write(&event_queue, WIRE_REC_PAGEFAULT, data, sizeof(struct page_fault_event));
+    hotpath_record(&handle_event_hist, start);
     return 0;
 }
 
+// Replay dispatch (--replay): recorded events re-enter the pipeline
+// through the same callback the live ring buffer drives
+static int replay_dispatch(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_PAGEFAULT || len < sizeof(struct page_fault_event)) {
+        return 0;
+    }
+    handle_event(NULL, (void *)payload, len);
+    return 1;
+}
+
+static uint64_t replay_record_ns(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_PAGEFAULT || len < sizeof(struct page_fault_event)) {
+        return 0;
+    }
+    return ((const struct page_fault_event *)payload)->timestamp;
+}
+
+// Serializer thread: drains the queue, formats and writes. Owns the wire
+// writer (and the --ipc ring) once started, so output batching and
+// self-telemetry emission move here from the poll loop.
+static void *serializer_main(void *arg)
+{
+    const struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000}; // 1ms
+
+    for (;;) {
+        uint8_t type;
+        uint32_t len;
+        const void *payload;
+        int drained = 0;
+
+        while ((payload = ipc_ring_next(&event_queue, &type, &len)) != NULL) {
+            if (len >= sizeof(struct page_fault_event)) {
+                serialize_event(payload);
+            }
+            ipc_ring_advance(&event_queue);
+            drained++;
+        }
+
+        wire_maybe_flush(&wire);
+        self_telemetry_maybe_emit(&selftel, &wire);
+
+        if (!drained) {
+            // Exit only once the producer has stopped and the queue is empty
+            if (serializer_stop) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
 static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
 {
     if (level >= LIBBPF_INFO) {
@@ -78,17 +215,221 @@ static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va
     return 0;
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --json                 Emit JSONL records (compatibility mode)\n"
+            "  --ipc PATH             Write binary records to a shared-memory ring at PATH\n"
+            "  --spool DIR            Append binary records to mmap segment files in DIR;\n"
+            "                         the ingestion side tails and resumes after restarts\n"
+            "  --realtime             Lock all memory and prefault the stack so the\n"
+            "                         collector never page-faults under pressure\n"
+            "  --rt-cpu N             Pin to housekeeping core N (implies --realtime)\n"
+            "  --rt-fifo PRIO         Elevate to SCHED_FIFO at PRIO 1-99 (implies --realtime)\n"
+            "  --flush-interval MS    Max output buffering delay (default %d)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each flush\n"
+            "                         ends a frame so consumers can decode incrementally\n"
+            "  --replay FILE          Replay a recorded binary capture (.bin or .zst)\n"
+            "                         through the pipeline instead of tracing; no BPF\n"
+            "                         or root required\n"
+            "  --replay-timed         Pace --replay records by their recorded timestamps\n"
+            "                         (default is max speed)\n"
+            "  --stats-socket PATH    Serve a JSON snapshot of the loader's own hot-path\n"
+            "                         latency histograms per connection at PATH\n"
+            "  --latency-mode         Consume events as soon as the kernel signals the\n"
+            "                         ring instead of on the 100ms poll tick\n"
+            "  --ringbuf-size BYTES   Kernel ring buffer size, rounded up to a\n"
+            "                         power-of-two multiple of the page size\n"
+            "  --minor-budget N       Minor faults per CPU per second before the\n"
+            "                         adaptive sampler backs off (default 5000)\n",
+            prog, WIRE_DEFAULT_FLUSH_MS);
+}
+
 int main(int argc, char **argv)
 {
-    struct bpf_object *obj = NULL;
-    struct bpf_program *prog_entry, *prog_exit;
-    struct bpf_link *link_entry = NULL, *link_exit = NULL;
+    struct page_fault_tracer_bpf *skel = NULL;
     struct ring_buffer *rb = NULL;
+    enum wire_format format = WIRE_FORMAT_BINARY;
+    unsigned int flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
+    unsigned int minor_budget = 0; // 0 = kernel-side default
     int err = 0;
     int map_fd;
+    int opt;
+    int realtime_mode = 0;
+    int rt_cpu = -1;
+    int rt_fifo = 0;
+    const char *compress_codec = NULL;
+    const char *ipc_path = NULL;
+    const char *spool_dir = NULL;
+    const char *replay_path = NULL;
+    const char *stats_socket = NULL;
+    int replay_timed = 0;
+    int latency_mode = 0;
+    unsigned long ringbuf_size = 0;
+
+    static const struct option long_opts[] = {
+        {"json", no_argument, NULL, 'j'},
+        {"ipc", required_argument, NULL, 'I'},
+        {"spool", required_argument, NULL, 'S'},
+        {"flush-interval", required_argument, NULL, 'f'},
+        {"compress", required_argument, NULL, 'z'},
+        {"latency-mode", no_argument, NULL, 'L'},
+        {"ringbuf-size", required_argument, NULL, 'r'},
+        {"minor-budget", required_argument, NULL, 'b'},
+        {"realtime", no_argument, NULL, 'R'},
+        {"rt-cpu", required_argument, NULL, 'A'},
+        {"rt-fifo", required_argument, NULL, 'F'},
+        {"replay", required_argument, NULL, 'P'},
+        {"replay-timed", no_argument, NULL, 'T'},
+        {"stats-socket", required_argument, NULL, 'U'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "jb:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'j':
+            format = WIRE_FORMAT_JSON;
+            break;
+        case 'I':
+            ipc_path = optarg;
+            break;
+        case 'S':
+            spool_dir = optarg;
+            break;
+        case 'f':
+            flush_interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'L':
+            latency_mode = 1;
+            break;
+        case 'r':
+            ringbuf_size = (unsigned long)atol(optarg);
+            break;
+        case 'b':
+            minor_budget = (unsigned int)atoi(optarg);
+            break;
+        case 'R':
+            realtime_mode = 1;
+            break;
+        case 'A':
+            rt_cpu = atoi(optarg);
+            if (rt_cpu < 0) {
+                fprintf(stderr, "ERROR: --rt-cpu must be a CPU number\n");
+                return 1;
+            }
+            break;
+        case 'F':
+            rt_fifo = atoi(optarg);
+            if (rt_fifo < 1 || rt_fifo > 99) {
+                fprintf(stderr, "ERROR: --rt-fifo must be 1-99\n");
+                return 1;
+            }
+            break;
+        case 'P':
+            replay_path = optarg;
+            break;
+        case 'T':
+            replay_timed = 1;
+            break;
+        case 'U':
+            stats_socket = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rt_cpu >= 0 || rt_fifo > 0) {
+        realtime_mode = 1;
+    }
+    if (realtime_mode && realtime_enter(rt_cpu, rt_fifo) != 0) {
+        return 1;
+    }
+
+    if (ipc_path) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --ipc carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_ring_create(&ipc, ipc_path, 0) != 0) {
+            return 1;
+        }
+        ipc_active = 1;
+    }
+
+    if (spool_dir) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --spool carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_active) {
+            fprintf(stderr, "ERROR: --spool and --ipc are mutually exclusive\n");
+            return 1;
+        }
+        if (spool_writer_open(&spool, spool_dir, 0, 0) != 0) {
+            return 1;
+        }
+        spool_active = 1;
+    }
+
+    // Set up batched output
+    if (wire_writer_init(&wire, STDOUT_FILENO, format, 0, flush_interval_ms) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+
+    // Self-instrumentation: histogram the event callback and expose it
+    // (with the wire writer's flush stalls) on the stats socket
+    hotpath_register(&handle_event_hist, "handle_event");
+    if (stats_socket && hotpath_stats_listen(stats_socket) != 0) {
+        return 1;
+    }
+
+    // Replay mode: feed a recorded capture through the serializer
+    // pipeline and report throughput; no BPF programs are loaded
+    if (replay_path) {
+        self_telemetry_init(&selftel, "pagefault", -1, -1);
+        if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+            return 1;
+        }
+
+        pthread_t serializer;
+        if (pthread_create(&serializer, NULL, serializer_main, NULL) != 0) {
+            fprintf(stderr, "ERROR: failed to start serializer thread\n");
+            return 1;
+        }
 
-    (void)argc; // Unused
-    (void)argv; // Unused
+        struct replay_stats rst;
+        err = replay_run(replay_path, replay_timed, replay_record_ns, replay_dispatch, &rst);
+
+        serializer_stop = 1;
+        pthread_join(serializer, NULL);
+        ipc_ring_close(&event_queue);
+        if (err == 0) {
+            replay_report(replay_path, &rst);
+        }
+        if (ipc_active) {
+            ipc_ring_close(&ipc);
+        }
+        if (spool_active) {
+            spool_writer_close(&spool);
+        }
+        hotpath_stats_close();
+        wire_writer_destroy(&wire);
+        return err != 0;
+    }
 
     // Set up libbpf logging
     libbpf_set_print(libbpf_print_fn);
@@ -99,64 +440,66 @@ int main(int argc, char **argv)
 
     fprintf(stderr, "Loading eBPF program...\n");
 
-    // Open BPF object file
-    obj = bpf_object__open_file("page_fault_tracer.bpf.o", NULL);
-    if (libbpf_get_error(obj)) {
-        fprintf(stderr, "ERROR: failed to open BPF object file\n");
-        fprintf(stderr, "Make sure page_fault_tracer.bpf.o exists and is compiled correctly\n");
+    // Open and load the embedded BPF skeleton (no .bpf.o file on disk)
+    skel = page_fault_tracer_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "ERROR: failed to open BPF skeleton\n");
         return 1;
     }
 
-    // Load BPF object into kernel
-    err = bpf_object__load(obj);
+    // Resize the event ring between open and load; the kernel requires a
+    // power-of-two multiple of the page size
+    if (ringbuf_size > 0) {
+        long page = sysconf(_SC_PAGESIZE);
+        unsigned long rounded = page > 0 ? (unsigned long)page : 4096;
+        while (rounded < ringbuf_size) {
+            rounded <<= 1;
+        }
+        if (rounded != ringbuf_size) {
+            fprintf(stderr, "WARNING: rounding ring buffer size up to %lu bytes\n", rounded);
+        }
+        err = bpf_map__set_max_entries(skel->maps.events, (unsigned int)rounded);
+        if (err) {
+            fprintf(stderr, "ERROR: failed to set ring buffer size: %d\n", err);
+            goto cleanup;
+        }
+    }
+
+    err = page_fault_tracer_bpf__load(skel);
     if (err) {
-        fprintf(stderr, "ERROR: failed to load BPF object: %d\n", err);
+        fprintf(stderr, "ERROR: failed to load BPF skeleton: %d\n", err);
         fprintf(stderr, "Check: 1) Running as root, 2) Kernel has BPF support, 3) BTF enabled\n");
         goto cleanup;
     }
 
     fprintf(stderr, "BPF program loaded successfully\n");
 
-    // Find BPF kprobe/kretprobe programs
-    prog_entry = bpf_object__find_program_by_name(obj, "trace_mm_fault_entry");
-    prog_exit = bpf_object__find_program_by_name(obj, "trace_mm_fault_exit");
-
-    if (!prog_entry || !prog_exit) {
-        fprintf(stderr, "ERROR: failed to find BPF programs\n");
-        fprintf(stderr,
-                "Expected: trace_mm_fault_entry (kprobe), trace_mm_fault_exit (kretprobe)\n");
-        err = -1;
-        goto cleanup;
+    // Push the minor fault budget to the kernel-side sampler
+    if (minor_budget > 0) {
+        unsigned int config_key = 0;
+        err = bpf_map_update_elem(bpf_map__fd(skel->maps.config), &config_key, &minor_budget,
+                                  BPF_ANY);
+        if (err) {
+            fprintf(stderr, "ERROR: failed to set minor fault budget: %d\n", err);
+            goto cleanup;
+        }
     }
 
-    // Attach kprobe on handle_mm_fault entry
-    link_entry = bpf_program__attach(prog_entry);
-    if (libbpf_get_error(link_entry)) {
-        fprintf(stderr, "ERROR: failed to attach kprobe to handle_mm_fault\n");
+    // Attach kprobe/kretprobe on handle_mm_fault
+    err = page_fault_tracer_bpf__attach(skel);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to attach kprobes: %d\n", err);
         fprintf(stderr, "Make sure kernel has kprobe support and handle_mm_fault symbol exists\n");
-        link_entry = NULL;
-        err = -1;
-        goto cleanup;
-    }
-
-    // Attach kretprobe on handle_mm_fault exit
-    link_exit = bpf_program__attach(prog_exit);
-    if (libbpf_get_error(link_exit)) {
-        fprintf(stderr, "ERROR: failed to attach kretprobe to handle_mm_fault\n");
-        link_exit = NULL;
-        err = -1;
         goto cleanup;
     }
 
     fprintf(stderr, "BPF kprobe/kretprobe attached to handle_mm_fault\n");
 
     // Get ring buffer map file descriptor
-    map_fd = bpf_object__find_map_fd_by_name(obj, "events");
-    if (map_fd < 0) {
-        fprintf(stderr, "ERROR: failed to find ring buffer map\n");
-        err = map_fd;
-        goto cleanup;
-    }
+    map_fd = bpf_map__fd(skel->maps.events);
+
+    // Track kernel-side drops and ring utilization
+    self_telemetry_init(&selftel, "pagefault", bpf_map__fd(skel->maps.prog_stats_map), map_fd);
 
     // Set up ring buffer consumer
     rb = ring_buffer__new(map_fd, handle_event, NULL, NULL);
@@ -166,28 +509,95 @@ int main(int argc, char **argv)
         goto cleanup;
     }
 
+    // Hand formatting and output off to a separate thread so the poll
+    // loop below does nothing but drain the kernel ring
+    if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+        err = -1;
+        goto cleanup;
+    }
+
+    pthread_t serializer;
+    err = pthread_create(&serializer, NULL, serializer_main, NULL);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to start serializer thread: %d\n", err);
+        ipc_ring_close(&event_queue);
+        goto cleanup;
+    }
+
     fprintf(stderr, "Tracing page faults... Press Ctrl+C to exit\n\n");
 
-    // Poll ring buffer for events
-    while (!exiting) {
-        err = ring_buffer__poll(rb, 100 /* timeout, ms */);
-        if (err == -EINTR) {
-            err = 0;
-            break;
+    if (latency_mode) {
+        // Latency mode: wait on the ring's epoll fd and consume the
+        // moment the kernel signals data, instead of on the poll tick
+        int rb_epoll_fd = ring_buffer__epoll_fd(rb);
+        struct epoll_event ev;
+
+        while (!exiting) {
+            int ready = epoll_wait(rb_epoll_fd, &ev, 1, 100);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    break;
+                }
+                fprintf(stderr, "ERROR: epoll_wait failed: %d\n", -errno);
+                err = -errno;
+                break;
+            }
+            if (ready > 0) {
+                err = ring_buffer__consume(rb);
+                if (err < 0) {
+                    fprintf(stderr, "ERROR: ring buffer consume failed: %d\n", err);
+                    break;
+                }
+                err = 0;
+            }
         }
-        if (err < 0) {
-            fprintf(stderr, "ERROR: ring buffer polling failed: %d\n", err);
-            break;
+    } else {
+        // Poll ring buffer for events
+        while (!exiting) {
+            err = ring_buffer__poll(rb, 100 /* timeout, ms */);
+            if (err == -EINTR) {
+                err = 0;
+                break;
+            }
+            if (err < 0) {
+                fprintf(stderr, "ERROR: ring buffer polling failed: %d\n", err);
+                break;
+            }
         }
     }
 
+    // Let the serializer drain what is queued, then join it before the
+    // wire writer is torn down
+    serializer_stop = 1;
+    pthread_join(serializer, NULL);
+    if (event_queue.dropped > 0) {
+        fprintf(stderr, "WARNING: %lu events dropped on full serializer queue\n",
+                (unsigned long)event_queue.dropped);
+    }
+    ipc_ring_close(&event_queue);
+
     fprintf(stderr, "\nShutting down...\n");
 
 cleanup:
     ring_buffer__free(rb);
-    bpf_link__destroy(link_entry);
-    bpf_link__destroy(link_exit);
-    bpf_object__close(obj);
+    page_fault_tracer_bpf__destroy(skel);
+    self_telemetry_destroy(&selftel);
+    if (ipc_active) {
+        if (ipc.dropped > 0) {
+            fprintf(stderr, "WARNING: %lu records dropped on full IPC ring\n",
+                    (unsigned long)ipc.dropped);
+        }
+        ipc_ring_close(&ipc);
+    }
+    if (spool_active) {
+        if (spool.recycled > 0) {
+            fprintf(stderr, "WARNING: %lu spool segments recycled before being consumed\n",
+                    (unsigned long)spool.recycled);
+        }
+        spool_writer_close(&spool);
+    }
+    hotpath_stats_close();
+    wire_writer_destroy(&wire);
 
     return err != 0;
 }
@@ -3,7 +3,8 @@
 //
 // Scheduler Events Tracer
 // Captures sched_switch and sched_wakeup events, computes per-process
-// context switch rates, and aggregates to 1-second buckets
+// context switch rates, and aggregates into per-CPU per-process buckets
+// that the loader merges and drains at the 1-second boundary
 
 // eBPF program using vmlinux.h from kernel BTF
 // Requires: Ubuntu 22.04+ LTS (kernel 5.15+) with BTF support
@@ -34,16 +35,9 @@ struct bucket_stats {
     __u32 timeslice_count;      // Number of timeslices for averaging
 };
 
-// Composite key for bucket aggregation: (pid, time_bucket)
-struct bucket_key {
-    __u32 pid;
-    __u64 time_bucket;
-};
-
 // Per-process tracking of last scheduled timestamp
 struct process_state {
-    __u64 last_switch_ts;     // Last time process was switched out
-    __u64 last_bucket;        // Last bucket we emitted for this process
+    __u64 last_switch_ts;     // Last time process was switched in
     char comm[TASK_COMM_LEN]; // Process name
 };
 
@@ -57,88 +51,101 @@ struct sched_wakeup_args {
     __u32 target_cpu; // Target CPU
 };
 
-// Hash map for per-process state tracking
+// LRU hash for per-process state tracking. Plain hash maps filled up on
+// container hosts churning short-lived PIDs (exited processes were never
+// deleted) and new processes silently stopped being tracked; LRU evicts
+// the stalest entry instead. sched_process_exit below deletes entries
+// proactively so eviction is the backstop, not the steady state. The
+// loader can resize both maps before load (--max-procs).
 struct {
-    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
     __uint(max_entries, 10240);
     __type(key, __u32);
     __type(value, struct process_state);
 } process_state_map SEC(".maps");
 
-// Hash map for 1-second bucket aggregates
+// Per-CPU LRU hash for bucket aggregates, keyed by pid. The switch path
+// fires on every core simultaneously; a shared hash map made all cores
+// hammer the same buckets, so each CPU keeps its own copy and the loader
+// merges them at the 1-second boundary (the same split io_latency_tracer
+// uses). LRU so a full map evicts the stalest bucket instead of dropping
+// every new process; the loader drains entries every second, so eviction
+// only bites under extreme churn within one interval.
 struct {
-    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
     __uint(max_entries, 10240);
-    __type(key, struct bucket_key);
+    __type(key, __u32);
     __type(value, struct bucket_stats);
 } bucket_aggregates SEC(".maps");
 
-// Ring buffer for emitting aggregated events
+// Self-telemetry counters (per-CPU; merged and emitted by the loader)
+struct prog_stats {
+    __u64 events_submitted; // Buckets created in the aggregation map
+    __u64 ringbuf_drops;    // Bucket creations lost to a full map
+};
+
 struct {
-    __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 256 * 1024); // 256KB ring buffer
-} events SEC(".maps");
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct prog_stats);
+} prog_stats_map SEC(".maps");
 
-// Helper function to emit bucket stats to userspace
-static __always_inline void emit_bucket_stats(struct bucket_key *key, struct bucket_stats *stats)
+// Count one submission or one drop (per-CPU, so plain increments suffice)
+static __always_inline void count_event(int dropped)
 {
-    struct bucket_stats *event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
-    if (!event) {
-        return;
+    __u32 key = 0;
+    struct prog_stats *stats = bpf_map_lookup_elem(&prog_stats_map, &key);
+    if (stats) {
+        if (dropped) {
+            stats->ringbuf_drops++;
+        } else {
+            stats->events_submitted++;
+        }
     }
-
-    // Copy stats to event
-    event->time_bucket = stats->time_bucket;
-    event->pid = stats->pid;
-    __builtin_memcpy(event->comm, stats->comm, TASK_COMM_LEN);
-    event->context_switches = stats->context_switches;
-    event->voluntary_switches = stats->voluntary_switches;
-    event->involuntary_switches = stats->involuntary_switches;
-    event->wakeups = stats->wakeups;
-    event->cpu_time_ns = stats->cpu_time_ns;
-    event->total_timeslice_ns = stats->total_timeslice_ns;
-    event->timeslice_count = stats->timeslice_count;
-
-    bpf_ringbuf_submit(event, 0);
 }
 
-// Helper function to update or create bucket stats
+// Update or create this CPU's bucket for one process. The lookup returns
+// the current CPU's copy, so the update is contention-free and needs no
+// atomics.
 static __always_inline void update_bucket_stats(__u32 pid, __u64 time_bucket, __u64 cpu_time,
                                                 int is_voluntary, int is_wakeup, char *comm)
 {
-    struct bucket_key key = {.pid = pid, .time_bucket = time_bucket};
+    struct bucket_stats *stats = bpf_map_lookup_elem(&bucket_aggregates, &pid);
+    if (!stats) {
+        // Create the entry. Another CPU may win the race; either way the
+        // follow-up lookup returns this CPU's own copy.
+        struct bucket_stats new_stats = {.time_bucket = time_bucket, .pid = pid};
+        __builtin_memcpy(new_stats.comm, comm, TASK_COMM_LEN);
+        bpf_map_update_elem(&bucket_aggregates, &pid, &new_stats, BPF_NOEXIST);
 
-    struct bucket_stats *stats = bpf_map_lookup_elem(&bucket_aggregates, &key);
-    if (stats) {
-        // Update existing bucket
-        if (is_wakeup) {
-            stats->wakeups++;
-        } else {
-            stats->context_switches++;
-            if (is_voluntary) {
-                stats->voluntary_switches++;
-            } else {
-                stats->involuntary_switches++;
-            }
-            stats->cpu_time_ns += cpu_time;
-            stats->total_timeslice_ns += cpu_time;
-            stats->timeslice_count++;
+        stats = bpf_map_lookup_elem(&bucket_aggregates, &pid);
+        if (!stats) {
+            count_event(1); // Map full: this bucket's counts are lost
+            return;
         }
-    } else {
-        // Create new bucket
-        struct bucket_stats new_stats = {.time_bucket = time_bucket,
-                                         .pid = pid,
-                                         .context_switches = is_wakeup ? 0 : 1,
-                                         .voluntary_switches = (is_wakeup || !is_voluntary) ? 0 : 1,
-                                         .involuntary_switches =
-                                             (is_wakeup || is_voluntary) ? 0 : 1,
-                                         .wakeups = is_wakeup ? 1 : 0,
-                                         .cpu_time_ns = cpu_time,
-                                         .total_timeslice_ns = cpu_time,
-                                         .timeslice_count = is_wakeup ? 0 : 1};
-        __builtin_memcpy(new_stats.comm, comm, TASK_COMM_LEN);
+        count_event(0);
+    }
+
+    // A race loser's copy starts zeroed; stamp the identifying fields
+    if (stats->comm[0] == 0) {
+        stats->time_bucket = time_bucket;
+        stats->pid = pid;
+        __builtin_memcpy(stats->comm, comm, TASK_COMM_LEN);
+    }
 
-        bpf_map_update_elem(&bucket_aggregates, &key, &new_stats, BPF_ANY);
+    if (is_wakeup) {
+        stats->wakeups++;
+    } else {
+        stats->context_switches++;
+        if (is_voluntary) {
+            stats->voluntary_switches++;
+        } else {
+            stats->involuntary_switches++;
+        }
+        stats->cpu_time_ns += cpu_time;
+        stats->total_timeslice_ns += cpu_time;
+        stats->timeslice_count++;
     }
 }
 
@@ -172,21 +179,9 @@ int trace_sched_switch(struct trace_event_raw_sched_switch *ctx)
             if (state->last_switch_ts > 0) {
                 cpu_time = now - state->last_switch_ts;
             }
-
-            // Check if we moved to a new bucket, emit old bucket if so
-            if (state->last_bucket != 0 && state->last_bucket != time_bucket) {
-                struct bucket_key old_key = {.pid = prev_pid, .time_bucket = state->last_bucket};
-                struct bucket_stats *old_stats = bpf_map_lookup_elem(&bucket_aggregates, &old_key);
-                if (old_stats) {
-                    emit_bucket_stats(&old_key, old_stats);
-                    bpf_map_delete_elem(&bucket_aggregates, &old_key);
-                }
-            }
-
-            state->last_bucket = time_bucket;
         } else {
             // First time seeing this process
-            struct process_state new_state = {.last_switch_ts = 0, .last_bucket = time_bucket};
+            struct process_state new_state = {.last_switch_ts = 0};
             bpf_probe_read_kernel_str(new_state.comm, TASK_COMM_LEN, ctx->prev_comm);
             bpf_map_update_elem(&process_state_map, &prev_pid, &new_state, BPF_ANY);
         }
@@ -203,7 +198,7 @@ int trace_sched_switch(struct trace_event_raw_sched_switch *ctx)
         if (next_state) {
             next_state->last_switch_ts = now;
         } else {
-            struct process_state new_state = {.last_switch_ts = now, .last_bucket = time_bucket};
+            struct process_state new_state = {.last_switch_ts = now};
             bpf_probe_read_kernel_str(new_state.comm, TASK_COMM_LEN, ctx->next_comm);
             bpf_map_update_elem(&process_state_map, &next_pid, &new_state, BPF_ANY);
         }
@@ -212,6 +207,34 @@ int trace_sched_switch(struct trace_event_raw_sched_switch *ctx)
     return 0;
 }
 
+// Tracepoint context for sched_process_exit
+// Based on kernel tracepoint format: /sys/kernel/debug/tracing/events/sched/sched_process_exit/format
+struct sched_process_exit_args {
+    __u64 pad;     // Common tracepoint header
+    char comm[16]; // Task command name
+    __u32 pid;     // Task PID
+    __u32 prio;    // Task priority
+};
+
+// Tracepoint for sched_process_exit
+// Frees the per-process state eagerly so exited PIDs never linger in the
+// map. The process's final bucket stays in bucket_aggregates on purpose:
+// the loader's next 1-second drain emits it through the normal path,
+// deleting it kernel-side here would lose those counts instead.
+SEC("tp/sched/sched_process_exit")
+int trace_sched_process_exit(struct sched_process_exit_args *ctx)
+{
+    __u32 pid = ctx->pid;
+
+    if (pid == 0) {
+        return 0; // Ignore idle process
+    }
+
+    bpf_map_delete_elem(&process_state_map, &pid);
+
+    return 0;
+}
+
 // Tracepoint for sched_wakeup
 // This captures when a process becomes runnable
 SEC("tp/sched/sched_wakeup")
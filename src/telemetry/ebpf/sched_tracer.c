@@ -2,11 +2,24 @@
 // Copyright (c) 2025 KernelSight AI
 //
 // Userspace loader for scheduler events tracer
-// Uses libbpf to load eBPF program and output aggregated events as JSON
+// Merges the kernel's per-CPU per-process buckets once per second and
+// outputs the aggregated records as JSON or binary frames
 
+#include "../common/self_telemetry.h"
+#include "../common/ipc_ring.h"
+#include "../common/hotpath.h"
+#include "../common/realtime.h"
+#include "../common/replay.h"
+#include "../common/spool.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+// Generated BPF skeleton: embeds the BPF object and provides typed map access
+#include "sched_tracer.skel.h"
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 #include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +28,17 @@
 #include <unistd.h>
 
 #define TASK_COMM_LEN 16
+#define DEFAULT_MAX_PROCS 10240 // Default max_entries of both state maps
+#define DEFAULT_TOP_PROCS 50    // Default K when --top is given without a value
+
+// Effective capacity of the kernel maps (set by --max-procs); the drain
+// walk sizes its key array from this
+static unsigned int max_procs = DEFAULT_MAX_PROCS;
+
+// Top-K mode (--top): per interval, emit only the K busiest processes
+// by context switches and by CPU time, plus one "[other]" rollup record
+// covering everything skipped so totals stay accurate. 0 = emit all.
+static unsigned int top_procs;
 
 // Event structure (must match BPF program)
 struct bucket_stats {
@@ -32,21 +56,62 @@ struct bucket_stats {
 
 static volatile sig_atomic_t exiting = 0;
 
+// Batched output writer shared by the JSON and binary emit paths
+static struct wire_writer wire;
+
+// Shared-memory ring transport (--ipc); NULL path means stdout only
+static struct ipc_ring ipc;
+static int ipc_active;
+
+// Store-and-forward segment spool (--spool); survives consumer restarts
+static struct spool_writer spool;
+static int spool_active;
+
+// Route one binary record to the spool or shared-memory ring when active,
+// otherwise to the batched stdout writer
+static void emit_record(uint8_t type, const void *payload, uint32_t len)
+{
+    if (spool_active) {
+        spool_write_record(&spool, type, payload, len);
+    } else if (ipc_active) {
+        ipc_ring_write(&ipc, type, payload, len);
+    } else {
+        wire_write_record(&wire, type, payload, len);
+    }
+}
+
+// Drop accounting and loader health, emitted on the same stream
+static struct self_telemetry selftel;
+
+// Cycle histogram for the per-second map drain and merge (--stats-socket / USDT)
+static struct hotpath_hist drain_hist;
+
+// In-process SPSC queue between the map drain (main thread) and the
+// serializer thread. Serializing inside the drain loop means a stalled
+// stdout consumer delays the next drain and buckets pile up in the
+// kernel map; this queue absorbs transient output stalls in cheap
+// userspace memory instead.
+#define EVENT_QUEUE_SIZE (8 * 1024 * 1024)
+static struct ipc_ring event_queue;
+static volatile int serializer_stop;
+
 static void sig_handler(int sig)
 {
     exiting = 1;
 }
 
-// Callback function for ring buffer events
-static int handle_event(void *ctx, void *data, size_t data_sz)
+// Format and write one merged bucket (serializer thread only)
+static void serialize_bucket(const struct bucket_stats *e)
 {
-    const struct bucket_stats *e = data;
+    char line[512];
     double cpu_time_ms;
     double avg_timeslice_us;
+    int len;
 
-    if (data_sz < sizeof(*e)) {
-        fprintf(stderr, "Error: event too small\n");
-        return 0;
+    // Binary mode: forward the merged bucket as one frame
+    if (wire.format == WIRE_FORMAT_BINARY) {
+        emit_record(WIRE_REC_SCHED, e, sizeof(*e));
+        return;
     }
 
     // Convert CPU time to milliseconds
@@ -58,15 +123,308 @@ static int handle_event(void *ctx, void *data, size_t data_sz)
         avg_timeslice_us = (e->total_timeslice_ns / (double)e->timeslice_count) / 1000.0;
     }
 
-    // Output as single-line JSON (JSONL format for streaming)
-    printf("{\"time_bucket\":%llu,\"pid\":%u,\"comm\":\"%s\",\"context_switches\":%llu,\"voluntary_"
-           "switches\":%llu,\"involuntary_switches\":%llu,\"wakeups\":%llu,\"cpu_time_ms\":%.3f,"
-           "\"avg_timeslice_us\":%.3f,\"type\":\"sched\"}\n",
-           e->time_bucket, e->pid, e->comm, e->context_switches, e->voluntary_switches,
-           e->involuntary_switches, e->wakeups, cpu_time_ms, avg_timeslice_us);
-    fflush(stdout);
+    // Serialize as single-line JSON (JSONL format for streaming)
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "time_bucket", e->time_bucket);
+    json_u64(&jw, "pid", e->pid);
+    json_str(&jw, "comm", e->comm);
+    json_u64(&jw, "context_switches", e->context_switches);
+    json_u64(&jw, "voluntary_switches", e->voluntary_switches);
+    json_u64(&jw, "involuntary_switches", e->involuntary_switches);
+    json_u64(&jw, "wakeups", e->wakeups);
+    json_double(&jw, "cpu_time_ms", cpu_time_ms, 3);
+    json_double(&jw, "avg_timeslice_us", avg_timeslice_us, 3);
+    json_str(&jw, "type", "sched");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
 
-    return 0;
+// Queue one merged bucket for the serializer thread
+static void emit_bucket(const struct bucket_stats *e)
+{
+    selftel.events_consumed++;
+    ipc_ring_write(&event_queue, WIRE_REC_SCHED, e, sizeof(*e));
+}
+
+// Replay dispatch (--replay): recorded sched records re-enter the
+// pipeline at the same point live merged buckets do
+static int replay_dispatch(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_SCHED || len < sizeof(struct bucket_stats)) {
+        return 0;
+    }
+    emit_bucket(payload);
+    return 1;
+}
+
+static uint64_t replay_record_ns(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_SCHED || len < sizeof(struct bucket_stats)) {
+        return 0;
+    }
+    // time_bucket is seconds since boot
+    return ((const struct bucket_stats *)payload)->time_bucket * 1000000000ULL;
+}
+
+// Serializer thread: drains the queue, formats and writes. Owns the wire
+// writer (and the --ipc ring) once started, so output batching and
+// self-telemetry emission move here from the drain loop.
+static void *serializer_main(void *arg)
+{
+    const struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000}; // 1ms
+
+    for (;;) {
+        uint8_t type;
+        uint32_t len;
+        const void *payload;
+        int drained = 0;
+
+        while ((payload = ipc_ring_next(&event_queue, &type, &len)) != NULL) {
+            if (len >= sizeof(struct bucket_stats)) {
+                serialize_bucket(payload);
+            }
+            ipc_ring_advance(&event_queue);
+            drained++;
+        }
+
+        wire_maybe_flush(&wire);
+        self_telemetry_maybe_emit(&selftel, &wire);
+
+        if (!drained) {
+            // Exit only once the producer has stopped and the queue is empty
+            if (serializer_stop) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// Merge one process's per-CPU buckets into a single record. The comm and
+// time_bucket come from the first CPU that actually touched the entry
+// (race losers' copies start zeroed).
+static void merge_bucket(const struct bucket_stats *cpu_stats, unsigned int nr_cpus, unsigned int pid,
+                         struct bucket_stats *merged)
+{
+    memset(merged, 0, sizeof(*merged));
+    merged->pid = pid;
+
+    for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+        if (merged->comm[0] == 0 && cpu_stats[cpu].comm[0] != 0) {
+            memcpy(merged->comm, cpu_stats[cpu].comm, TASK_COMM_LEN);
+            merged->time_bucket = cpu_stats[cpu].time_bucket;
+        }
+        merged->context_switches += cpu_stats[cpu].context_switches;
+        merged->voluntary_switches += cpu_stats[cpu].voluntary_switches;
+        merged->involuntary_switches += cpu_stats[cpu].involuntary_switches;
+        merged->wakeups += cpu_stats[cpu].wakeups;
+        merged->cpu_time_ns += cpu_stats[cpu].cpu_time_ns;
+        merged->total_timeslice_ns += cpu_stats[cpu].total_timeslice_ns;
+        merged->timeslice_count += cpu_stats[cpu].timeslice_count;
+    }
+}
+
+// Ranking key for the top-K selection: busiest by context switches or
+// by accumulated CPU time, depending on which heap is asking
+static unsigned long long topk_key(const struct bucket_stats *b, int by_cpu_time)
+{
+    return by_cpu_time ? b->cpu_time_ns : b->context_switches;
+}
+
+// Bounded min-heap of indices into the merged-bucket array. The root is
+// the smallest key currently kept, so a full heap admits a candidate
+// only when it beats the weakest member — one O(log K) pass per bucket
+// instead of sorting the whole interval.
+struct topk_heap {
+    int *idx;
+    unsigned int size;
+    unsigned int cap;
+    int by_cpu_time;
+};
+
+static void topk_sift_down(struct topk_heap *h, const struct bucket_stats *buckets, unsigned int i)
+{
+    for (;;) {
+        unsigned int left = 2 * i + 1;
+        unsigned int right = 2 * i + 2;
+        unsigned int smallest = i;
+
+        if (left < h->size &&
+            topk_key(&buckets[h->idx[left]], h->by_cpu_time) <
+                topk_key(&buckets[h->idx[smallest]], h->by_cpu_time)) {
+            smallest = left;
+        }
+        if (right < h->size &&
+            topk_key(&buckets[h->idx[right]], h->by_cpu_time) <
+                topk_key(&buckets[h->idx[smallest]], h->by_cpu_time)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+
+        int tmp = h->idx[i];
+        h->idx[i] = h->idx[smallest];
+        h->idx[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void topk_offer(struct topk_heap *h, const struct bucket_stats *buckets, int candidate)
+{
+    if (h->size < h->cap) {
+        // Still filling: push up from the bottom
+        unsigned int i = h->size++;
+        h->idx[i] = candidate;
+        while (i > 0) {
+            unsigned int parent = (i - 1) / 2;
+            if (topk_key(&buckets[h->idx[parent]], h->by_cpu_time) <=
+                topk_key(&buckets[h->idx[i]], h->by_cpu_time)) {
+                break;
+            }
+            int tmp = h->idx[i];
+            h->idx[i] = h->idx[parent];
+            h->idx[parent] = tmp;
+            i = parent;
+        }
+        return;
+    }
+
+    if (topk_key(&buckets[candidate], h->by_cpu_time) >
+        topk_key(&buckets[h->idx[0]], h->by_cpu_time)) {
+        h->idx[0] = candidate;
+        topk_sift_down(h, buckets, 0);
+    }
+}
+
+// Emit the union of the top-K buckets by context switches and by CPU
+// time, then fold everything skipped into a single "[other]" record so
+// interval totals survive the cut
+static void emit_top_buckets(struct bucket_stats *buckets, int count)
+{
+    struct topk_heap by_switches = {.by_cpu_time = 0};
+    struct topk_heap by_cpu = {.by_cpu_time = 1};
+    unsigned char *picked;
+
+    by_switches.idx = calloc(top_procs, sizeof(int));
+    by_cpu.idx = calloc(top_procs, sizeof(int));
+    picked = calloc(count, sizeof(unsigned char));
+    if (!by_switches.idx || !by_cpu.idx || !picked) {
+        // Degrade to emitting everything rather than dropping the interval
+        for (int i = 0; i < count; i++) {
+            emit_bucket(&buckets[i]);
+        }
+        goto out;
+    }
+    by_switches.cap = top_procs;
+    by_cpu.cap = top_procs;
+
+    for (int i = 0; i < count; i++) {
+        topk_offer(&by_switches, buckets, i);
+        topk_offer(&by_cpu, buckets, i);
+    }
+    for (unsigned int i = 0; i < by_switches.size; i++) {
+        picked[by_switches.idx[i]] = 1;
+    }
+    for (unsigned int i = 0; i < by_cpu.size; i++) {
+        picked[by_cpu.idx[i]] = 1;
+    }
+
+    struct bucket_stats other;
+    int skipped = 0;
+    memset(&other, 0, sizeof(other));
+    memcpy(other.comm, "[other]", 8);
+
+    for (int i = 0; i < count; i++) {
+        if (picked[i]) {
+            emit_bucket(&buckets[i]);
+            continue;
+        }
+        other.time_bucket = buckets[i].time_bucket;
+        other.context_switches += buckets[i].context_switches;
+        other.voluntary_switches += buckets[i].voluntary_switches;
+        other.involuntary_switches += buckets[i].involuntary_switches;
+        other.wakeups += buckets[i].wakeups;
+        other.cpu_time_ns += buckets[i].cpu_time_ns;
+        other.total_timeslice_ns += buckets[i].total_timeslice_ns;
+        other.timeslice_count += buckets[i].timeslice_count;
+        skipped++;
+    }
+    if (skipped > 0) {
+        emit_bucket(&other);
+    }
+
+out:
+    free(by_switches.idx);
+    free(by_cpu.idx);
+    free(picked);
+}
+
+// Walk the per-CPU bucket map, emit one merged record per process (or
+// the top-K slice when --top is set), then delete the drained entries
+// so the next interval starts fresh
+static void drain_buckets(int map_fd)
+{
+    uint64_t hp_start = hotpath_cycles();
+    unsigned int nr_cpus = libbpf_num_possible_cpus();
+    struct bucket_stats *cpu_stats;
+    struct bucket_stats *merged;
+    unsigned int *keys;
+    int key_count = 0;
+    int merged_count = 0;
+
+    cpu_stats = calloc(nr_cpus, sizeof(struct bucket_stats));
+    keys = calloc(max_procs, sizeof(unsigned int));
+    merged = calloc(max_procs, sizeof(struct bucket_stats));
+    if (!cpu_stats || !keys || !merged) {
+        free(cpu_stats);
+        free(keys);
+        free(merged);
+        return;
+    }
+
+    // Collect keys first: deleting while iterating restarts the walk
+    unsigned int key, next_key;
+    unsigned int *cur = NULL;
+    while (key_count < (int)max_procs && bpf_map_get_next_key(map_fd, cur, &next_key) == 0) {
+        keys[key_count++] = next_key;
+        key = next_key;
+        cur = &key;
+    }
+
+    for (int i = 0; i < key_count; i++) {
+        if (bpf_map_lookup_elem(map_fd, &keys[i], cpu_stats) != 0) {
+            continue;
+        }
+
+        merge_bucket(cpu_stats, nr_cpus, keys[i], &merged[merged_count]);
+
+        if (merged[merged_count].context_switches > 0 || merged[merged_count].wakeups > 0) {
+            merged_count++;
+        }
+
+        bpf_map_delete_elem(map_fd, &keys[i]);
+    }
+
+    if (top_procs > 0 && merged_count > (int)top_procs) {
+        emit_top_buckets(merged, merged_count);
+    } else {
+        for (int i = 0; i < merged_count; i++) {
+            emit_bucket(&merged[i]);
+        }
+    }
+
+    free(cpu_stats);
+    free(keys);
+    free(merged);
+    hotpath_record(&drain_hist, hp_start);
 }
 
 static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va_list args)
@@ -77,14 +435,220 @@ static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va
     return 0;
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --json                 Emit JSONL records (compatibility mode)\n"
+            "  --ipc PATH             Write binary records to a shared-memory ring at PATH\n"
+            "  --spool DIR            Append binary records to mmap segment files in DIR;\n"
+            "                         the ingestion side tails and resumes after restarts\n"
+            "  --realtime             Lock all memory and prefault the stack so the\n"
+            "                         collector never page-faults under pressure\n"
+            "  --rt-cpu N             Pin to housekeeping core N (implies --realtime)\n"
+            "  --rt-fifo PRIO         Elevate to SCHED_FIFO at PRIO 1-99 (implies --realtime)\n"
+            "  --flush-interval MS    Max output buffering delay (default %d)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each flush\n"
+            "                         ends a frame so consumers can decode incrementally\n"
+            "  --max-procs N          Capacity of the kernel state maps (default %d);\n"
+            "                         size for the host's peak concurrent PIDs\n"
+            "  --top[=N]              Per interval, emit only the N busiest processes by\n"
+            "                         context switches and by CPU time plus one \"[other]\"\n"
+            "                         rollup (default %d when N is omitted)\n"
+            "  --replay FILE          Replay a recorded binary capture (.bin or .zst)\n"
+            "                         through the pipeline instead of tracing; no BPF\n"
+            "                         or root required\n"
+            "  --replay-timed         Pace --replay records by their recorded timestamps\n"
+            "                         (default is max speed)\n"
+            "  --stats-socket PATH    Serve a JSON snapshot of the loader's own hot-path\n"
+            "                         latency histograms per connection at PATH\n",
+            prog, WIRE_DEFAULT_FLUSH_MS, DEFAULT_MAX_PROCS, DEFAULT_TOP_PROCS);
+}
+
 int main(int argc, char **argv)
 {
-    struct bpf_object *obj = NULL;
-    struct bpf_program *prog_switch, *prog_wakeup;
-    struct bpf_link *link_switch = NULL, *link_wakeup = NULL;
-    struct ring_buffer *rb = NULL;
+    struct sched_tracer_bpf *skel = NULL;
+    enum wire_format format = WIRE_FORMAT_BINARY;
+    unsigned int flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
     int err = 0;
     int map_fd;
+    int opt;
+    int realtime_mode = 0;
+    int rt_cpu = -1;
+    int rt_fifo = 0;
+    const char *compress_codec = NULL;
+    const char *ipc_path = NULL;
+    const char *spool_dir = NULL;
+    const char *replay_path = NULL;
+    const char *stats_socket = NULL;
+    int replay_timed = 0;
+
+    static const struct option long_opts[] = {
+        {"json", no_argument, NULL, 'j'},
+        {"ipc", required_argument, NULL, 'I'},
+        {"spool", required_argument, NULL, 'S'},
+        {"flush-interval", required_argument, NULL, 'f'},
+        {"compress", required_argument, NULL, 'z'},
+        {"max-procs", required_argument, NULL, 'm'},
+        {"top", optional_argument, NULL, 'k'},
+        {"replay", required_argument, NULL, 'P'},
+        {"replay-timed", no_argument, NULL, 'T'},
+        {"stats-socket", required_argument, NULL, 'U'},
+        {"realtime", no_argument, NULL, 'R'},
+        {"rt-cpu", required_argument, NULL, 'A'},
+        {"rt-fifo", required_argument, NULL, 'F'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "jh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'j':
+            format = WIRE_FORMAT_JSON;
+            break;
+        case 'I':
+            ipc_path = optarg;
+            break;
+        case 'S':
+            spool_dir = optarg;
+            break;
+        case 'f':
+            flush_interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'm':
+            max_procs = (unsigned int)atoi(optarg);
+            if (max_procs == 0) {
+                fprintf(stderr, "ERROR: --max-procs must be positive\n");
+                return 1;
+            }
+            break;
+        case 'k':
+            top_procs = optarg ? (unsigned int)atoi(optarg) : DEFAULT_TOP_PROCS;
+            if (top_procs == 0) {
+                fprintf(stderr, "ERROR: --top must be positive\n");
+                return 1;
+            }
+            break;
+        case 'P':
+            replay_path = optarg;
+            break;
+        case 'T':
+            replay_timed = 1;
+            break;
+        case 'U':
+            stats_socket = optarg;
+            break;
+        case 'R':
+            realtime_mode = 1;
+            break;
+        case 'A':
+            rt_cpu = atoi(optarg);
+            if (rt_cpu < 0) {
+                fprintf(stderr, "ERROR: --rt-cpu must be a CPU number\n");
+                return 1;
+            }
+            break;
+        case 'F':
+            rt_fifo = atoi(optarg);
+            if (rt_fifo < 1 || rt_fifo > 99) {
+                fprintf(stderr, "ERROR: --rt-fifo must be 1-99\n");
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rt_cpu >= 0 || rt_fifo > 0) {
+        realtime_mode = 1;
+    }
+    if (realtime_mode && realtime_enter(rt_cpu, rt_fifo) != 0) {
+        return 1;
+    }
+
+    if (ipc_path) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --ipc carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_ring_create(&ipc, ipc_path, 0) != 0) {
+            return 1;
+        }
+        ipc_active = 1;
+    }
+
+    if (spool_dir) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --spool carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_active) {
+            fprintf(stderr, "ERROR: --spool and --ipc are mutually exclusive\n");
+            return 1;
+        }
+        if (spool_writer_open(&spool, spool_dir, 0, 0) != 0) {
+            return 1;
+        }
+        spool_active = 1;
+    }
+
+    // Set up batched output
+    if (wire_writer_init(&wire, STDOUT_FILENO, format, 0, flush_interval_ms) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+
+    // Self-instrumentation: histogram the drain-and-merge pass and
+    // expose it (with the wire writer's flush stalls) on the stats socket
+    hotpath_register(&drain_hist, "drain_buckets");
+    if (stats_socket && hotpath_stats_listen(stats_socket) != 0) {
+        return 1;
+    }
+
+    // Replay mode: feed a recorded capture through the serializer
+    // pipeline and report throughput; no BPF programs are loaded
+    if (replay_path) {
+        self_telemetry_init(&selftel, "sched", -1, -1);
+        if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+            return 1;
+        }
+
+        pthread_t serializer;
+        if (pthread_create(&serializer, NULL, serializer_main, NULL) != 0) {
+            fprintf(stderr, "ERROR: failed to start serializer thread\n");
+            return 1;
+        }
+
+        struct replay_stats rst;
+        err = replay_run(replay_path, replay_timed, replay_record_ns, replay_dispatch, &rst);
+
+        serializer_stop = 1;
+        pthread_join(serializer, NULL);
+        ipc_ring_close(&event_queue);
+        if (err == 0) {
+            replay_report(replay_path, &rst);
+        }
+        if (ipc_active) {
+            ipc_ring_close(&ipc);
+        }
+        if (spool_active) {
+            spool_writer_close(&spool);
+        }
+        hotpath_stats_close();
+        wire_writer_destroy(&wire);
+        return err != 0;
+    }
 
     // Set up libbpf logging
     libbpf_set_print(libbpf_print_fn);
@@ -95,92 +659,104 @@ int main(int argc, char **argv)
 
     fprintf(stderr, "Loading eBPF scheduler tracer...\n");
 
-    // Open BPF object file
-    obj = bpf_object__open_file("sched_tracer.bpf.o", NULL);
-    if (libbpf_get_error(obj)) {
-        fprintf(stderr, "ERROR: failed to open BPF object file\n");
-        fprintf(stderr, "Make sure sched_tracer.bpf.o exists and is compiled correctly\n");
+    // Open and load the embedded BPF skeleton (no .bpf.o file on disk)
+    skel = sched_tracer_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "ERROR: failed to open BPF skeleton\n");
         return 1;
     }
 
-    // Load BPF object into kernel
-    err = bpf_object__load(obj);
+    // Resize both state maps between open and load so big container
+    // hosts can track 100k+ concurrent PIDs
+    if (max_procs != DEFAULT_MAX_PROCS) {
+        err = bpf_map__set_max_entries(skel->maps.process_state_map, max_procs);
+        if (!err) {
+            err = bpf_map__set_max_entries(skel->maps.bucket_aggregates, max_procs);
+        }
+        if (err) {
+            fprintf(stderr, "ERROR: failed to set map capacity: %d\n", err);
+            goto cleanup;
+        }
+    }
+
+    err = sched_tracer_bpf__load(skel);
     if (err) {
-        fprintf(stderr, "ERROR: failed to load BPF object: %d\n", err);
+        fprintf(stderr, "ERROR: failed to load BPF skeleton: %d\n", err);
         fprintf(stderr, "Check: 1) Running as root, 2) Kernel has BPF support, 3) BTF enabled\n");
         goto cleanup;
     }
 
     fprintf(stderr, "BPF program loaded successfully\n");
 
-    // Find BPF programs
-    prog_switch = bpf_object__find_program_by_name(obj, "trace_sched_switch");
-    prog_wakeup = bpf_object__find_program_by_name(obj, "trace_sched_wakeup");
-
-    if (!prog_switch || !prog_wakeup) {
-        fprintf(stderr, "ERROR: failed to find BPF programs\n");
-        fprintf(stderr, "Expected programs: trace_sched_switch, trace_sched_wakeup\n");
-        err = -1;
-        goto cleanup;
-    }
-
     // Attach BPF programs to tracepoints
-    link_switch = bpf_program__attach(prog_switch);
-    if (libbpf_get_error(link_switch)) {
-        fprintf(stderr, "ERROR: failed to attach sched_switch tracepoint\n");
-        link_switch = NULL;
-        err = -1;
-        goto cleanup;
-    }
-
-    link_wakeup = bpf_program__attach(prog_wakeup);
-    if (libbpf_get_error(link_wakeup)) {
-        fprintf(stderr, "ERROR: failed to attach sched_wakeup tracepoint\n");
-        link_wakeup = NULL;
-        err = -1;
+    err = sched_tracer_bpf__attach(skel);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to attach tracepoints: %d\n", err);
         goto cleanup;
     }
 
     fprintf(stderr, "BPF programs attached to tracepoints\n");
 
-    // Get ring buffer map file descriptor
-    map_fd = bpf_object__find_map_fd_by_name(obj, "events");
-    if (map_fd < 0) {
-        fprintf(stderr, "ERROR: failed to find ring buffer map\n");
-        err = map_fd;
+    // Get the per-CPU bucket aggregation map
+    map_fd = bpf_map__fd(skel->maps.bucket_aggregates);
+
+    // Track kernel-side losses (no ring buffer in this design)
+    self_telemetry_init(&selftel, "sched", bpf_map__fd(skel->maps.prog_stats_map), -1);
+
+    // Hand formatting and output off to a separate thread so the drain
+    // loop below never waits on output
+    if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+        err = -1;
         goto cleanup;
     }
 
-    // Set up ring buffer consumer
-    rb = ring_buffer__new(map_fd, handle_event, NULL, NULL);
-    if (!rb) {
-        fprintf(stderr, "ERROR: failed to create ring buffer\n");
-        err = -1;
+    pthread_t serializer;
+    err = pthread_create(&serializer, NULL, serializer_main, NULL);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to start serializer thread: %d\n", err);
+        ipc_ring_close(&event_queue);
         goto cleanup;
     }
 
     fprintf(stderr, "Tracing scheduler events (1-second buckets)... Press Ctrl+C to exit\n\n");
 
-    // Poll ring buffer for events
+    // Merge and queue the per-CPU buckets once per second
     while (!exiting) {
-        err = ring_buffer__poll(rb, 100 /* timeout, ms */);
-        if (err == -EINTR) {
-            err = 0;
-            break;
-        }
-        if (err < 0) {
-            fprintf(stderr, "ERROR: ring buffer polling failed: %d\n", err);
-            break;
-        }
+        sleep(1);
+        drain_buckets(map_fd);
     }
 
+    // Let the serializer drain what is queued, then join it before the
+    // wire writer is torn down
+    serializer_stop = 1;
+    pthread_join(serializer, NULL);
+    if (event_queue.dropped > 0) {
+        fprintf(stderr, "WARNING: %lu records dropped on full serializer queue\n",
+                (unsigned long)event_queue.dropped);
+    }
+    ipc_ring_close(&event_queue);
+
     fprintf(stderr, "\nShutting down...\n");
 
 cleanup:
-    ring_buffer__free(rb);
-    bpf_link__destroy(link_switch);
-    bpf_link__destroy(link_wakeup);
-    bpf_object__close(obj);
+    sched_tracer_bpf__destroy(skel);
+    self_telemetry_destroy(&selftel);
+    if (ipc_active) {
+        if (ipc.dropped > 0) {
+            fprintf(stderr, "WARNING: %lu records dropped on full IPC ring\n",
+                    (unsigned long)ipc.dropped);
+        }
+        ipc_ring_close(&ipc);
+    }
+    if (spool_active) {
+        if (spool.recycled > 0) {
+            fprintf(stderr, "WARNING: %lu spool segments recycled before being consumed\n",
+                    (unsigned long)spool.recycled);
+        }
+        spool_writer_close(&spool);
+    }
+    hotpath_stats_close();
+    wire_writer_destroy(&wire);
 
     return err != 0;
 }
@@ -14,6 +14,24 @@
 
 #define TASK_COMM_LEN 16
 #define LATENCY_THRESHOLD_NS 10000000ULL // 10ms in nanoseconds
+#define MAX_SLOTS 32                     // Log2 histogram slots (covers 0 to 2^31 microseconds)
+
+// Operating modes (selected by the loader via the config map)
+#define MODE_PER_EVENT 0 // Emit one ring buffer event per slow syscall
+#define MODE_AGGREGATE 1 // Aggregate per (pid, syscall) histograms in-kernel
+
+// Config map slots
+#define CONFIG_MODE 0          // Operating mode (MODE_*)
+#define CONFIG_FILTER_FLAGS 1  // Active filters (FILTER_*)
+#define CONFIG_CATEGORY_MASK 2 // Enabled SYSCALL_CAT_* bits for FILTER_CATEGORIES
+
+// Filter flags (bitmask in CONFIG_FILTER_FLAGS)
+#define FILTER_PIDS 0x1       // Only trace PIDs present in filter_pids
+#define FILTER_CGROUPS 0x2    // Only trace cgroups present in filter_cgroups
+#define FILTER_SYSCALLS 0x4   // Only trace syscalls set in filter_syscalls bitmap
+#define FILTER_CATEGORIES 0x8 // Only trace syscalls whose category matches the mask
+
+#define MAX_FILTERED_SYSCALLS 512 // Bitmap capacity (8 x 64-bit words)
 
 // Event structure sent to userspace
 struct syscall_event {
@@ -36,6 +54,26 @@ struct syscall_entry_data {
     __u64 arg0;      // First syscall argument
 };
 
+// Latency histogram (log2 buckets, microseconds)
+struct hist {
+    __u32 slots[MAX_SLOTS];
+};
+
+// Aggregation key: one entry per (pid, syscall) pair
+struct syscall_agg_key {
+    __u32 pid;
+    __u32 syscall_nr;
+};
+
+// Aggregated per-key statistics for aggregate mode
+struct syscall_agg {
+    struct hist latency_hist;
+    __u64 count;
+    __u64 error_count;
+    __u64 total_latency_ns;
+    char comm[TASK_COMM_LEN];
+};
+
 // Hash map to store syscall entry data
 // Key: thread ID, Value: entry data (timestamp + arg0)
 struct {
@@ -45,18 +83,214 @@ struct {
     __type(value, struct syscall_entry_data);
 } syscall_start SEC(".maps");
 
+// Aggregation map for aggregate mode, drained by the loader each second
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 10240);
+    __type(key, struct syscall_agg_key);
+    __type(value, struct syscall_agg);
+} syscall_aggregates SEC(".maps");
+
+// Config map: slot 0 holds the operating mode, slot 1 the filter flags,
+// slot 2 the enabled category mask
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 3);
+    __type(key, __u32);
+    __type(value, __u32);
+} config SEC(".maps");
+
+// Allowed PIDs when FILTER_PIDS is set
+// Updatable at runtime (bpf_map_update_elem from the loader, or bpftool)
+// without detaching the programs.
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 1024);
+    __type(key, __u32);
+    __type(value, __u8);
+} filter_pids SEC(".maps");
+
+// Allowed cgroup IDs when FILTER_CGROUPS is set
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 256);
+    __type(key, __u64);
+    __type(value, __u8);
+} filter_cgroups SEC(".maps");
+
+// Allowed syscall numbers when FILTER_SYSCALLS is set (one bit per syscall)
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_FILTERED_SYSCALLS / 64);
+    __type(key, __u32);
+    __type(value, __u64);
+} filter_syscalls SEC(".maps");
+
+// Per-syscall category bitmask (SYSCALL_CAT_* in the generated
+// syscall_names.h), copied in by the loader at startup from the
+// build-time classification table. Used when FILTER_CATEGORIES is set.
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_FILTERED_SYSCALLS);
+    __type(key, __u32);
+    __type(value, __u8);
+} syscall_categories SEC(".maps");
+
+// Check active filters before doing any work on the sys_enter hot path.
+// Returns 1 if the current task/syscall should be traced.
+static __always_inline int filters_pass(__u32 pid, __u64 syscall_nr)
+{
+    __u32 flags_key = CONFIG_FILTER_FLAGS;
+    __u32 *flags = bpf_map_lookup_elem(&config, &flags_key);
+    if (!flags || *flags == 0) {
+        return 1; // No filters configured
+    }
+
+    if (*flags & FILTER_PIDS) {
+        if (!bpf_map_lookup_elem(&filter_pids, &pid)) {
+            return 0;
+        }
+    }
+
+    if (*flags & FILTER_CGROUPS) {
+        __u64 cgroup_id = bpf_get_current_cgroup_id();
+        if (!bpf_map_lookup_elem(&filter_cgroups, &cgroup_id)) {
+            return 0;
+        }
+    }
+
+    if (*flags & FILTER_SYSCALLS) {
+        if (syscall_nr >= MAX_FILTERED_SYSCALLS) {
+            return 0;
+        }
+        __u32 word_idx = syscall_nr / 64;
+        __u64 *word = bpf_map_lookup_elem(&filter_syscalls, &word_idx);
+        if (!word || !(*word & (1ULL << (syscall_nr & 63)))) {
+            return 0;
+        }
+    }
+
+    if (*flags & FILTER_CATEGORIES) {
+        if (syscall_nr >= MAX_FILTERED_SYSCALLS) {
+            return 0;
+        }
+        __u32 mask_key = CONFIG_CATEGORY_MASK;
+        __u32 *mask = bpf_map_lookup_elem(&config, &mask_key);
+        __u32 nr_key = (__u32)syscall_nr;
+        __u8 *cat = bpf_map_lookup_elem(&syscall_categories, &nr_key);
+        if (!mask || !cat || !(*cat & *mask)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 // Ring buffer for sending events to userspace
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
     __uint(max_entries, 256 * 1024); // 256KB ring buffer
 } events SEC(".maps");
 
+// Self-telemetry counters (per-CPU; merged and emitted by the loader)
+struct prog_stats {
+    __u64 events_submitted; // Successful ring buffer submissions
+    __u64 ringbuf_drops;    // Failed bpf_ringbuf_reserve() calls
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct prog_stats);
+} prog_stats_map SEC(".maps");
+
+// Count one submission or one drop (per-CPU, so plain increments suffice)
+static __always_inline void count_event(int dropped)
+{
+    __u32 key = 0;
+    struct prog_stats *stats = bpf_map_lookup_elem(&prog_stats_map, &key);
+    if (stats) {
+        if (dropped) {
+            stats->ringbuf_drops++;
+        } else {
+            stats->events_submitted++;
+        }
+    }
+}
+
+// Helper: Calculate log2 of a value for histogram bucketing
+// Uses manual loop instead of __builtin_clzll to avoid LLVM backend issues
+static __always_inline __u32 log2(__u64 v)
+{
+    __u32 slot = 0;
+    __u64 temp = v;
+
+    // Handle edge case
+    if (v == 0) {
+        return 0;
+    }
+
+// Manual bit scan (unrolled for BPF verifier)
+#pragma unroll
+    for (int i = 5; i >= 0; i--) {
+        __u32 shift = (1 << i);
+        if (temp >= (1ULL << shift)) {
+            slot += shift;
+            temp >>= shift;
+        }
+    }
+
+    if (slot >= MAX_SLOTS) {
+        slot = MAX_SLOTS - 1;
+    }
+
+    return slot;
+}
+
+// Fold one completed syscall into the aggregation map
+static __always_inline void aggregate_syscall(__u32 pid, __u32 syscall_nr, __u64 latency_ns,
+                                              int is_error)
+{
+    struct syscall_agg_key key = {
+        .pid = pid,
+        .syscall_nr = syscall_nr,
+    };
+    __u32 slot = log2(latency_ns / 1000); // Histogram is in microseconds
+
+    struct syscall_agg *agg = bpf_map_lookup_elem(&syscall_aggregates, &key);
+    if (agg) {
+        __sync_fetch_and_add(&agg->latency_hist.slots[slot], 1);
+        __sync_fetch_and_add(&agg->count, 1);
+        __sync_fetch_and_add(&agg->total_latency_ns, latency_ns);
+        if (is_error) {
+            __sync_fetch_and_add(&agg->error_count, 1);
+        }
+    } else {
+        struct syscall_agg new_agg = {
+            .count = 1,
+            .error_count = is_error ? 1 : 0,
+            .total_latency_ns = latency_ns,
+        };
+        new_agg.latency_hist.slots[slot] = 1;
+        bpf_get_current_comm(&new_agg.comm, sizeof(new_agg.comm));
+
+        bpf_map_update_elem(&syscall_aggregates, &key, &new_agg, BPF_ANY);
+    }
+}
+
 // Tracepoint for syscall entry
 SEC("tracepoint/raw_syscalls/sys_enter")
 int trace_syscall_enter(struct trace_event_raw_sys_enter *ctx)
 {
     __u64 tid = bpf_get_current_pid_tgid();
     __u32 tid_key = (__u32)tid;
+    __u32 pid = tid >> 32;
+
+    // Untraced tasks pay only the filter lookups, not a map insert
+    if (!filters_pass(pid, ctx->id)) {
+        return 0;
+    }
 
     // Capture entry data: timestamp and first argument
     struct syscall_entry_data entry_data = {
@@ -87,6 +321,18 @@ int trace_syscall_exit(struct trace_event_raw_sys_exit *ctx)
     __u64 end_ts = bpf_ktime_get_ns();
     __u64 latency = end_ts - entry_data->timestamp;
 
+    // Aggregate mode: fold every syscall into the per-(pid, syscall) map
+    // and never touch the ring buffer; the loader drains the map each second.
+    // Unlike per-event mode there is no latency threshold, so the histograms
+    // cover the full latency distribution.
+    __u32 config_key = 0;
+    __u32 *mode = bpf_map_lookup_elem(&config, &config_key);
+    if (mode && *mode == MODE_AGGREGATE) {
+        aggregate_syscall(pid, ctx->id, latency, ctx->ret < 0);
+        bpf_map_delete_elem(&syscall_start, &tid);
+        return 0;
+    }
+
     // Filter: only emit events for high-latency syscalls (>10ms)
     if (latency < LATENCY_THRESHOLD_NS) {
         bpf_map_delete_elem(&syscall_start, &tid);
@@ -96,6 +342,7 @@ int trace_syscall_exit(struct trace_event_raw_sys_exit *ctx)
     // Reserve space in ring buffer
     struct syscall_event *event = bpf_ringbuf_reserve(&events, sizeof(*event), 0);
     if (!event) {
+        count_event(1); // Ring full: the event is lost, make that visible
         bpf_map_delete_elem(&syscall_start, &tid);
         return 0;
     }
@@ -115,6 +362,7 @@ int trace_syscall_exit(struct trace_event_raw_sys_exit *ctx)
 
     // Submit event to userspace
     bpf_ringbuf_submit(event, 0);
+    count_event(0);
 
     // Clean up entry from map
     bpf_map_delete_elem(&syscall_start, &tid);
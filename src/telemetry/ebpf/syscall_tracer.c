@@ -6,16 +6,51 @@
 
 // Include generated syscall names - build will fail if not generated
 #include "../common/syscall_names.h"
+#include "../common/self_telemetry.h"
+#include "../common/ipc_ring.h"
+#include "../common/hotpath.h"
+#include "../common/realtime.h"
+#include "../common/replay.h"
+#include "../common/spool.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+// Generated BPF skeleton: embeds the BPF object and provides typed map access
+#include "syscall_tracer.skel.h"
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
+#include <ctype.h>
 #include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#define MAX_SLOTS 32
+
+// Operating modes (must match BPF program)
+#define MODE_PER_EVENT 0
+#define MODE_AGGREGATE 1
+
+// Config map slots (must match BPF program)
+#define CONFIG_MODE 0
+#define CONFIG_FILTER_FLAGS 1
+#define CONFIG_CATEGORY_MASK 2
+
+// Filter flags (must match BPF program)
+#define FILTER_PIDS 0x1
+#define FILTER_CGROUPS 0x2
+#define FILTER_SYSCALLS 0x4
+#define FILTER_CATEGORIES 0x8
+
+#define MAX_FILTERED_SYSCALLS 512
+#define MAX_FILTER_ARGS 64 // CLI-supplied PIDs/cgroups/syscalls per kind
+
 // Event structure (must match BPF program)
 struct syscall_event {
     unsigned long long timestamp;
@@ -31,25 +66,100 @@ struct syscall_event {
     char comm[16];
 };
 
+// Latency histogram (must match BPF program)
+struct hist {
+    unsigned int slots[MAX_SLOTS];
+};
+
+// Aggregation key (must match BPF program)
+struct syscall_agg_key {
+    unsigned int pid;
+    unsigned int syscall_nr;
+};
+
+// Aggregated per-key statistics (must match BPF program)
+struct syscall_agg {
+    struct hist latency_hist;
+    unsigned long long count;
+    unsigned long long error_count;
+    unsigned long long total_latency_ns;
+    char comm[16];
+};
+
+// Binary wire record for one aggregate summary (WIRE_REC_SYSCALL_AGG payload)
+struct syscall_agg_record {
+    unsigned long long timestamp;
+    unsigned int pid;
+    unsigned int syscall_nr;
+    unsigned long long count;
+    unsigned long long error_count;
+    double avg_latency_us;
+    double p50_us;
+    double p95_us;
+    double p99_us;
+    char comm[16];
+};
+
 static volatile sig_atomic_t exiting = 0;
 
+// Batched output writer shared by the JSON and binary emit paths
+static struct wire_writer wire;
+
+// Shared-memory ring transport (--ipc); NULL path means stdout only
+static struct ipc_ring ipc;
+static int ipc_active;
+
+// Store-and-forward segment spool (--spool); survives consumer restarts
+static struct spool_writer spool;
+static int spool_active;
+
+// Route one binary record to the spool or shared-memory ring when active,
+// otherwise to the batched stdout writer
+static void emit_record(uint8_t type, const void *payload, uint32_t len)
+{
+    if (spool_active) {
+        spool_write_record(&spool, type, payload, len);
+    } else if (ipc_active) {
+        ipc_ring_write(&ipc, type, payload, len);
+    } else {
+        wire_write_record(&wire, type, payload, len);
+    }
+}
+
+// Drop accounting and loader health, emitted on the same stream
+static struct self_telemetry selftel;
+
+// Cycle histogram for the ring buffer callback (--stats-socket / USDT)
+static struct hotpath_hist handle_event_hist;
+
+// In-process SPSC queue between the ring buffer consumer (main thread)
+// and the serializer thread. Serializing inside the ring buffer callback
+// means a stalled stdout consumer blocks ring_buffer__poll() and the
+// 256KB kernel ring overflows; this queue absorbs transient output
+// stalls in cheap userspace memory instead.
+#define EVENT_QUEUE_SIZE (8 * 1024 * 1024)
+static struct ipc_ring event_queue;
+static volatile int serializer_stop;
+
 static void sig_handler(int sig)
 {
     exiting = 1;
 }
 
-// Callback function for ring buffer events
-static int handle_event(void *ctx, void *data, size_t data_sz)
+// Format and write one kernel event (serializer thread only)
+static void serialize_event(const struct syscall_event *e)
 {
-    const struct syscall_event *e = data;
+    struct json_writer jw;
     struct tm *tm;
     time_t t;
     char ts_str[64];
-    double latency_ms;
+    char line[512];
+    int len;
 
-    if (data_sz < sizeof(*e)) {
-        fprintf(stderr, "Error: event too small\n");
-        return 0;
+    // Binary mode: forward the kernel event verbatim as one frame
+    if (wire.format == WIRE_FORMAT_BINARY) {
+        emit_record(WIRE_REC_SYSCALL, e, sizeof(*e));
+        return;
     }
 
     // Convert timestamp to human-readable format
@@ -57,25 +167,345 @@ static int handle_event(void *ctx, void *data, size_t data_sz)
     tm = localtime(&t);
     strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", tm);
 
-    // Convert latency to milliseconds
-    latency_ms = e->latency_ns / 1000000.0;
-
-    // Output as single-line JSON for pipeline compatibility
-    printf("{\"timestamp\":%llu,\"time_str\":\"%s\",\"pid\":%u,\"tid\":%u,\"cpu\":%u,\"uid\":%u,\"syscall\":%u,\"syscall_name\":\"%s\",\"latency_ms\":%.3f,\"ret_value\":%lld,\"is_error\":%s,\"arg0\":%llu,\"comm\":\"%s\"}\n",
-        e->timestamp,
-        ts_str,
-        e->pid,
-        e->tid,
-        e->cpu,
-        e->uid,
-        e->syscall_nr,
-        get_syscall_name(e->syscall_nr),
-        latency_ms,
-        e->ret_value,
-        e->is_error ? "true" : "false",
-        e->arg0,
-        e->comm);
-    fflush(stdout);
+    // Serialize as single-line JSON for pipeline compatibility
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", e->timestamp);
+    json_str(&jw, "time_str", ts_str);
+    json_u64(&jw, "pid", e->pid);
+    json_u64(&jw, "tid", e->tid);
+    json_u64(&jw, "cpu", e->cpu);
+    json_u64(&jw, "uid", e->uid);
+    json_u64(&jw, "syscall", e->syscall_nr);
+    json_str(&jw, "syscall_name", get_syscall_name(e->syscall_nr));
+    json_double(&jw, "latency_ms", e->latency_ns / 1000000.0, 3);
+    json_i64(&jw, "ret_value", e->ret_value);
+    json_bool(&jw, "is_error", e->is_error);
+    json_u64(&jw, "arg0", e->arg0);
+    json_str(&jw, "comm", e->comm);
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+// Callback function for ring buffer events: only copies the event into
+// the userspace queue, so the poll loop never waits on output
+static int handle_event(void *ctx, void *data, size_t data_sz)
+{
+    uint64_t start = hotpath_cycles();
+
+    if (data_sz < sizeof(struct syscall_event)) {
+        fprintf(stderr, "Error: event too small\n");
+        return 0;
+    }
+
+    selftel.events_consumed++;
+    ipc_ring_write(&event_queue, WIRE_REC_SYSCALL, data, sizeof(struct syscall_event));
+    hotpath_record(&handle_event_hist, start);
+    return 0;
+}
+
+// Replay dispatch (--replay): recorded events re-enter the pipeline
+// through the same callback the live ring buffer drives
+static int replay_dispatch(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_SYSCALL || len < sizeof(struct syscall_event)) {
+        return 0;
+    }
+    handle_event(NULL, (void *)payload, len);
+    return 1;
+}
+
+static uint64_t replay_record_ns(uint8_t type, const void *payload, uint32_t len)
+{
+    if (type != WIRE_REC_SYSCALL || len < sizeof(struct syscall_event)) {
+        return 0;
+    }
+    return ((const struct syscall_event *)payload)->timestamp;
+}
+
+// Serializer thread: drains the queue, formats and writes. Owns the wire
+// writer (and the --ipc ring) once started, so output batching and
+// self-telemetry emission move here from the poll loop.
+static void *serializer_main(void *arg)
+{
+    const struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000}; // 1ms
+
+    for (;;) {
+        uint8_t type;
+        uint32_t len;
+        const void *payload;
+        int drained = 0;
+
+        while ((payload = ipc_ring_next(&event_queue, &type, &len)) != NULL) {
+            if (len >= sizeof(struct syscall_event)) {
+                serialize_event(payload);
+            }
+            ipc_ring_advance(&event_queue);
+            drained++;
+        }
+
+        wire_maybe_flush(&wire);
+        self_telemetry_maybe_emit(&selftel, &wire);
+
+        if (!drained) {
+            // Exit only once the producer has stopped and the queue is empty
+            if (serializer_stop) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// Calculate percentile from histogram (log2 buckets, microseconds)
+static double calculate_percentile(const struct hist *h, unsigned long long total,
+                                   double percentile)
+{
+    if (total == 0) {
+        return 0.0;
+    }
+
+    unsigned long long target = (unsigned long long)(total * percentile / 100.0);
+    unsigned long long cumulative = 0;
+
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        cumulative += h->slots[i];
+
+        if (cumulative >= target) {
+            // Bucket i represents range [2^i, 2^(i+1)); midpoint approximation
+            unsigned long long bucket_start = (i == 0) ? 0 : (1ULL << i);
+            unsigned long long bucket_end = (1ULL << (i + 1));
+
+            return (bucket_start + bucket_end) / 2.0;
+        }
+    }
+
+    return (1ULL << MAX_SLOTS) / 2.0;
+}
+
+// Emit one aggregate summary record (binary frame or JSONL line)
+static void emit_agg_record(const struct syscall_agg_key *key, const struct syscall_agg *agg,
+                            unsigned long long timestamp)
+{
+    double avg_latency_us = 0.0;
+    char line[512];
+    int len;
+
+    selftel.events_consumed++;
+
+    if (agg->count > 0) {
+        avg_latency_us = (agg->total_latency_ns / (double)agg->count) / 1000.0;
+    }
+
+    double p50 = calculate_percentile(&agg->latency_hist, agg->count, 50.0);
+    double p95 = calculate_percentile(&agg->latency_hist, agg->count, 95.0);
+    double p99 = calculate_percentile(&agg->latency_hist, agg->count, 99.0);
+
+    if (wire.format == WIRE_FORMAT_BINARY) {
+        struct syscall_agg_record rec = {
+            .timestamp = timestamp,
+            .pid = key->pid,
+            .syscall_nr = key->syscall_nr,
+            .count = agg->count,
+            .error_count = agg->error_count,
+            .avg_latency_us = avg_latency_us,
+            .p50_us = p50,
+            .p95_us = p95,
+            .p99_us = p99,
+        };
+        memcpy(rec.comm, agg->comm, sizeof(rec.comm));
+        emit_record(WIRE_REC_SYSCALL_AGG, &rec, sizeof(rec));
+        return;
+    }
+
+    struct json_writer jw;
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_u64(&jw, "interval_seconds", 1);
+    json_u64(&jw, "pid", key->pid);
+    json_u64(&jw, "syscall", key->syscall_nr);
+    json_str(&jw, "syscall_name", get_syscall_name(key->syscall_nr));
+    json_str(&jw, "comm", agg->comm);
+    json_u64(&jw, "count", agg->count);
+    json_u64(&jw, "error_count", agg->error_count);
+    json_double(&jw, "avg_latency_us", avg_latency_us, 3);
+    json_double(&jw, "p50_us", p50, 2);
+    json_double(&jw, "p95_us", p95, 2);
+    json_double(&jw, "p99_us", p99, 2);
+    json_str(&jw, "type", "syscall_agg");
+    json_obj_end(&jw);
+    len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_write_json(&wire, line, len);
+    }
+}
+
+// Drain the aggregation map: emit one summary per key, then delete the key
+static void drain_aggregates(int agg_map_fd)
+{
+    struct syscall_agg_key key, next_key;
+    struct syscall_agg agg;
+    unsigned long long timestamp = time(NULL) * 1000000000ULL;
+    int err;
+
+    err = bpf_map_get_next_key(agg_map_fd, NULL, &next_key);
+    while (err == 0) {
+        key = next_key;
+        err = bpf_map_get_next_key(agg_map_fd, &key, &next_key);
+
+        if (bpf_map_lookup_elem(agg_map_fd, &key, &agg) == 0) {
+            emit_agg_record(&key, &agg, timestamp);
+        }
+        bpf_map_delete_elem(agg_map_fd, &key);
+    }
+}
+
+// Resolve a --syscall argument (number or name) to a syscall number
+static int parse_syscall_arg(const char *arg)
+{
+    if (isdigit((unsigned char)arg[0])) {
+        return atoi(arg);
+    }
+
+    for (unsigned int nr = 0; nr < MAX_SYSCALL_NR; nr++) {
+        if (syscall_names[nr] && strcmp(syscall_names[nr], arg) == 0) {
+            return (int)nr;
+        }
+    }
+
+    return -1;
+}
+
+// Resolve a --cgroup argument (numeric ID or cgroup v2 path) to a cgroup ID
+// The cgroup ID seen by bpf_get_current_cgroup_id() is the cgroupfs inode number.
+static long long parse_cgroup_arg(const char *arg)
+{
+    if (isdigit((unsigned char)arg[0])) {
+        return atoll(arg);
+    }
+
+    struct stat st;
+    if (stat(arg, &st) < 0) {
+        return -1;
+    }
+    return (long long)st.st_ino;
+}
+
+// Map a comma-separated category list (e.g. "io,net") onto the
+// SYSCALL_CAT_* bits from the generated classification table.
+// Returns the mask, or 0 on an unknown category name.
+static unsigned int parse_category_list(const char *arg)
+{
+    static const struct {
+        const char *name;
+        unsigned int bit;
+    } categories[] = {
+        {"io", SYSCALL_CAT_IO},     {"net", SYSCALL_CAT_NET},
+        {"mem", SYSCALL_CAT_MEM},   {"ipc", SYSCALL_CAT_IPC},
+        {"sched", SYSCALL_CAT_SCHED},
+    };
+    unsigned int mask = 0;
+    char buf[128];
+    char *tok, *save = NULL;
+
+    snprintf(buf, sizeof(buf), "%s", arg);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        unsigned int bit = 0;
+        for (size_t i = 0; i < sizeof(categories) / sizeof(categories[0]); i++) {
+            if (strcmp(tok, categories[i].name) == 0) {
+                bit = categories[i].bit;
+                break;
+            }
+        }
+        if (bit == 0) {
+            fprintf(stderr, "ERROR: unknown category '%s' (io, net, mem, ipc, sched)\n", tok);
+            return 0;
+        }
+        mask |= bit;
+    }
+    return mask;
+}
+
+// Populate the kernel-side filter maps from CLI arguments
+// The maps stay updatable at runtime (e.g. bpftool map update) without
+// detaching the programs.
+static int install_filters(struct syscall_tracer_bpf *skel, const unsigned int *pids,
+                           int pid_count, const unsigned long long *cgroups, int cgroup_count,
+                           const int *syscalls, int syscall_count, unsigned int category_mask)
+{
+    unsigned int flags = 0;
+    unsigned char one = 1;
+
+    if (pid_count > 0) {
+        int fd = bpf_map__fd(skel->maps.filter_pids);
+        for (int i = 0; i < pid_count; i++) {
+            if (bpf_map_update_elem(fd, &pids[i], &one, BPF_ANY) < 0) {
+                return -1;
+            }
+        }
+        flags |= FILTER_PIDS;
+    }
+
+    if (cgroup_count > 0) {
+        int fd = bpf_map__fd(skel->maps.filter_cgroups);
+        for (int i = 0; i < cgroup_count; i++) {
+            if (bpf_map_update_elem(fd, &cgroups[i], &one, BPF_ANY) < 0) {
+                return -1;
+            }
+        }
+        flags |= FILTER_CGROUPS;
+    }
+
+    if (syscall_count > 0) {
+        int fd = bpf_map__fd(skel->maps.filter_syscalls);
+
+        // Build the bitmap in userspace, then write each 64-bit word
+        unsigned long long bitmap[MAX_FILTERED_SYSCALLS / 64] = {0};
+        for (int i = 0; i < syscall_count; i++) {
+            if (syscalls[i] >= 0 && syscalls[i] < MAX_FILTERED_SYSCALLS) {
+                bitmap[syscalls[i] / 64] |= 1ULL << (syscalls[i] & 63);
+            }
+        }
+        for (unsigned int word = 0; word < MAX_FILTERED_SYSCALLS / 64; word++) {
+            if (bpf_map_update_elem(fd, &word, &bitmap[word], BPF_ANY) < 0) {
+                return -1;
+            }
+        }
+        flags |= FILTER_SYSCALLS;
+    }
+
+    if (category_mask != 0) {
+        // Copy the build-time classification table into the kernel so the
+        // category check is one array index at sys_enter
+        int fd = bpf_map__fd(skel->maps.syscall_categories);
+        for (unsigned int nr = 0; nr < MAX_FILTERED_SYSCALLS; nr++) {
+            unsigned char cat = nr < SYSCALL_CATEGORIES_COUNT ? syscall_categories[nr] : 0;
+            if (bpf_map_update_elem(fd, &nr, &cat, BPF_ANY) < 0) {
+                return -1;
+            }
+        }
+
+        int config_fd = bpf_map__fd(skel->maps.config);
+        unsigned int mask_key = CONFIG_CATEGORY_MASK;
+        if (bpf_map_update_elem(config_fd, &mask_key, &category_mask, BPF_ANY) < 0) {
+            return -1;
+        }
+        flags |= FILTER_CATEGORIES;
+    }
+
+    if (flags != 0) {
+        int fd = bpf_map__fd(skel->maps.config);
+        unsigned int key = CONFIG_FILTER_FLAGS;
+        if (bpf_map_update_elem(fd, &key, &flags, BPF_ANY) < 0) {
+            return -1;
+        }
+    }
 
     return 0;
 }
@@ -88,14 +518,270 @@ static int libbpf_print_fn(enum libbpf_print_level level, const char *format, va
     return 0;
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --aggregate            Aggregate per (pid, syscall) histograms in-kernel\n"
+            "                         and emit one summary per key per second\n"
+            "  --pid PID              Only trace this PID (repeatable)\n"
+            "  --cgroup ID|PATH       Only trace this cgroup (repeatable)\n"
+            "  --syscall NR|NAME      Only trace this syscall (repeatable)\n"
+            "  --categories LIST      Only trace syscall categories (comma-separated:\n"
+            "                         io, net, mem, ipc, sched); enforced in-kernel\n"
+            "  --json                 Emit JSONL records (compatibility mode)\n"
+            "  --ipc PATH             Write binary records to a shared-memory ring at PATH\n"
+            "  --spool DIR            Append binary records to mmap segment files in DIR;\n"
+            "                         the ingestion side tails and resumes after restarts\n"
+            "  --realtime             Lock all memory and prefault the stack so the\n"
+            "                         collector never page-faults under pressure\n"
+            "  --rt-cpu N             Pin to housekeeping core N (implies --realtime)\n"
+            "  --rt-fifo PRIO         Elevate to SCHED_FIFO at PRIO 1-99 (implies --realtime)\n"
+            "  --flush-interval MS    Max output buffering delay (default %d)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each flush\n"
+            "                         ends a frame so consumers can decode incrementally\n"
+            "  --replay FILE          Replay a recorded binary capture (.bin or .zst)\n"
+            "                         through the pipeline instead of tracing; no BPF\n"
+            "                         or root required\n"
+            "  --replay-timed         Pace --replay records by their recorded timestamps\n"
+            "                         (default is max speed)\n"
+            "  --stats-socket PATH    Serve a JSON snapshot of the loader's own hot-path\n"
+            "                         latency histograms per connection at PATH\n"
+            "  --latency-mode         Consume events as soon as the kernel signals the\n"
+            "                         ring instead of on the 100ms poll tick\n"
+            "  --ringbuf-size BYTES   Kernel ring buffer size, rounded up to a\n"
+            "                         power-of-two multiple of the page size\n"
+            "\nFilters are enforced in the kernel at sys_enter; the filter maps can be\n"
+            "updated at runtime (e.g. with bpftool) without detaching the programs.\n",
+            prog, WIRE_DEFAULT_FLUSH_MS);
+}
+
 int main(int argc, char **argv)
 {
-    struct bpf_object *obj = NULL;
-    struct bpf_program *prog_enter, *prog_exit;
-    struct bpf_link *link_enter = NULL, *link_exit = NULL;
+    struct syscall_tracer_bpf *skel = NULL;
     struct ring_buffer *rb = NULL;
+    enum wire_format format = WIRE_FORMAT_BINARY;
+    unsigned int flush_interval_ms = WIRE_DEFAULT_FLUSH_MS;
+    unsigned int mode = MODE_PER_EVENT;
+    unsigned int filter_pid_list[MAX_FILTER_ARGS];
+    unsigned long long filter_cgroup_list[MAX_FILTER_ARGS];
+    int filter_syscall_list[MAX_FILTER_ARGS];
+    int filter_pid_count = 0, filter_cgroup_count = 0, filter_syscall_count = 0;
+    unsigned int category_mask = 0;
     int err = 0;
     int map_fd;
+    int opt;
+    int realtime_mode = 0;
+    int rt_cpu = -1;
+    int rt_fifo = 0;
+    const char *compress_codec = NULL;
+    const char *ipc_path = NULL;
+    const char *spool_dir = NULL;
+    const char *replay_path = NULL;
+    const char *stats_socket = NULL;
+    int replay_timed = 0;
+    int latency_mode = 0;
+    unsigned long ringbuf_size = 0;
+
+    static const struct option long_opts[] = {
+        {"aggregate", no_argument, NULL, 'a'},
+        {"pid", required_argument, NULL, 'p'},
+        {"cgroup", required_argument, NULL, 'c'},
+        {"syscall", required_argument, NULL, 's'},
+        {"categories", required_argument, NULL, 'C'},
+        {"json", no_argument, NULL, 'j'},
+        {"ipc", required_argument, NULL, 'I'},
+        {"spool", required_argument, NULL, 'S'},
+        {"flush-interval", required_argument, NULL, 'f'},
+        {"compress", required_argument, NULL, 'z'},
+        {"latency-mode", no_argument, NULL, 'L'},
+        {"ringbuf-size", required_argument, NULL, 'r'},
+        {"realtime", no_argument, NULL, 'R'},
+        {"rt-cpu", required_argument, NULL, 'A'},
+        {"rt-fifo", required_argument, NULL, 'F'},
+        {"replay", required_argument, NULL, 'P'},
+        {"replay-timed", no_argument, NULL, 'T'},
+        {"stats-socket", required_argument, NULL, 'U'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "ap:c:s:jh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'a':
+            mode = MODE_AGGREGATE;
+            break;
+        case 'p':
+            if (filter_pid_count < MAX_FILTER_ARGS) {
+                filter_pid_list[filter_pid_count++] = (unsigned int)atoi(optarg);
+            }
+            break;
+        case 'c': {
+            long long cgroup_id = parse_cgroup_arg(optarg);
+            if (cgroup_id < 0) {
+                fprintf(stderr, "ERROR: cannot resolve cgroup '%s'\n", optarg);
+                return 1;
+            }
+            if (filter_cgroup_count < MAX_FILTER_ARGS) {
+                filter_cgroup_list[filter_cgroup_count++] = (unsigned long long)cgroup_id;
+            }
+            break;
+        }
+        case 's': {
+            int nr = parse_syscall_arg(optarg);
+            if (nr < 0 || nr >= MAX_FILTERED_SYSCALLS) {
+                fprintf(stderr, "ERROR: unknown syscall '%s'\n", optarg);
+                return 1;
+            }
+            if (filter_syscall_count < MAX_FILTER_ARGS) {
+                filter_syscall_list[filter_syscall_count++] = nr;
+            }
+            break;
+        }
+        case 'C':
+            category_mask = parse_category_list(optarg);
+            if (category_mask == 0) {
+                return 1;
+            }
+            break;
+        case 'j':
+            format = WIRE_FORMAT_JSON;
+            break;
+        case 'I':
+            ipc_path = optarg;
+            break;
+        case 'S':
+            spool_dir = optarg;
+            break;
+        case 'f':
+            flush_interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'L':
+            latency_mode = 1;
+            break;
+        case 'r':
+            ringbuf_size = (unsigned long)atol(optarg);
+            break;
+        case 'R':
+            realtime_mode = 1;
+            break;
+        case 'A':
+            rt_cpu = atoi(optarg);
+            if (rt_cpu < 0) {
+                fprintf(stderr, "ERROR: --rt-cpu must be a CPU number\n");
+                return 1;
+            }
+            break;
+        case 'F':
+            rt_fifo = atoi(optarg);
+            if (rt_fifo < 1 || rt_fifo > 99) {
+                fprintf(stderr, "ERROR: --rt-fifo must be 1-99\n");
+                return 1;
+            }
+            break;
+        case 'P':
+            replay_path = optarg;
+            break;
+        case 'T':
+            replay_timed = 1;
+            break;
+        case 'U':
+            stats_socket = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rt_cpu >= 0 || rt_fifo > 0) {
+        realtime_mode = 1;
+    }
+    if (realtime_mode && realtime_enter(rt_cpu, rt_fifo) != 0) {
+        return 1;
+    }
+
+    if (ipc_path) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --ipc carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_ring_create(&ipc, ipc_path, 0) != 0) {
+            return 1;
+        }
+        ipc_active = 1;
+    }
+
+    if (spool_dir) {
+        if (format == WIRE_FORMAT_JSON) {
+            fprintf(stderr, "ERROR: --spool carries binary records; drop --json\n");
+            return 1;
+        }
+        if (ipc_active) {
+            fprintf(stderr, "ERROR: --spool and --ipc are mutually exclusive\n");
+            return 1;
+        }
+        if (spool_writer_open(&spool, spool_dir, 0, 0) != 0) {
+            return 1;
+        }
+        spool_active = 1;
+    }
+
+    // Set up batched output
+    if (wire_writer_init(&wire, STDOUT_FILENO, format, 0, flush_interval_ms) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+
+    // Self-instrumentation: histogram the event callback and expose it
+    // (with the wire writer's flush stalls) on the stats socket
+    hotpath_register(&handle_event_hist, "handle_event");
+    if (stats_socket && hotpath_stats_listen(stats_socket) != 0) {
+        return 1;
+    }
+
+    // Replay mode: feed a recorded capture through the serializer
+    // pipeline and report throughput; no BPF programs are loaded
+    if (replay_path) {
+        self_telemetry_init(&selftel, "syscall", -1, -1);
+        if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+            return 1;
+        }
+
+        pthread_t serializer;
+        if (pthread_create(&serializer, NULL, serializer_main, NULL) != 0) {
+            fprintf(stderr, "ERROR: failed to start serializer thread\n");
+            return 1;
+        }
+
+        struct replay_stats rst;
+        err = replay_run(replay_path, replay_timed, replay_record_ns, replay_dispatch, &rst);
+
+        serializer_stop = 1;
+        pthread_join(serializer, NULL);
+        ipc_ring_close(&event_queue);
+        if (err == 0) {
+            replay_report(replay_path, &rst);
+        }
+        if (ipc_active) {
+            ipc_ring_close(&ipc);
+        }
+        if (spool_active) {
+            spool_writer_close(&spool);
+        }
+        hotpath_stats_close();
+        wire_writer_destroy(&wire);
+        return err != 0;
+    }
 
     // Set up libbpf logging
     libbpf_set_print(libbpf_print_fn);
@@ -106,61 +792,92 @@ int main(int argc, char **argv)
 
     fprintf(stderr, "Loading eBPF program...\n");
 
-    // Open BPF object file
-    obj = bpf_object__open_file("syscall_tracer.bpf.o", NULL);
-    if (libbpf_get_error(obj)) {
-        fprintf(stderr, "ERROR: failed to open BPF object file\n");
-        fprintf(stderr, "Make sure syscall_tracer.bpf.o exists and is compiled correctly\n");
+    // Open and load the embedded BPF skeleton (no .bpf.o file on disk)
+    skel = syscall_tracer_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "ERROR: failed to open BPF skeleton\n");
         return 1;
     }
 
-    // Load BPF object into kernel
-    err = bpf_object__load(obj);
+    // Resize the event ring between open and load; the kernel requires a
+    // power-of-two multiple of the page size
+    if (ringbuf_size > 0) {
+        long page = sysconf(_SC_PAGESIZE);
+        unsigned long rounded = page > 0 ? (unsigned long)page : 4096;
+        while (rounded < ringbuf_size) {
+            rounded <<= 1;
+        }
+        if (rounded != ringbuf_size) {
+            fprintf(stderr, "WARNING: rounding ring buffer size up to %lu bytes\n", rounded);
+        }
+        err = bpf_map__set_max_entries(skel->maps.events, (unsigned int)rounded);
+        if (err) {
+            fprintf(stderr, "ERROR: failed to set ring buffer size: %d\n", err);
+            goto cleanup;
+        }
+    }
+
+    err = syscall_tracer_bpf__load(skel);
     if (err) {
-        fprintf(stderr, "ERROR: failed to load BPF object: %d\n", err);
+        fprintf(stderr, "ERROR: failed to load BPF skeleton: %d\n", err);
         fprintf(stderr, "Check: 1) Running as root, 2) Kernel has BPF support, 3) BTF enabled\n");
         goto cleanup;
     }
 
     fprintf(stderr, "BPF program loaded successfully\n");
 
-    // Find BPF programs
-    prog_enter = bpf_object__find_program_by_name(obj, "trace_syscall_enter");
-    prog_exit = bpf_object__find_program_by_name(obj, "trace_syscall_exit");
-
-    if (!prog_enter || !prog_exit) {
-        fprintf(stderr, "ERROR: failed to find BPF programs\n");
-        err = -1;
+    // Attach BPF programs to tracepoints
+    err = syscall_tracer_bpf__attach(skel);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to attach tracepoints: %d\n", err);
         goto cleanup;
     }
 
-    // Attach BPF programs to tracepoints
-    link_enter = bpf_program__attach(prog_enter);
-    if (libbpf_get_error(link_enter)) {
-        fprintf(stderr, "ERROR: failed to attach sys_enter tracepoint\n");
-        link_enter = NULL;
-        err = -1;
+    fprintf(stderr, "BPF programs attached to tracepoints\n");
+
+    // Publish the operating mode to the BPF program
+    int config_fd = bpf_map__fd(skel->maps.config);
+    unsigned int config_key = CONFIG_MODE;
+    err = bpf_map_update_elem(config_fd, &config_key, &mode, BPF_ANY);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to set operating mode: %d\n", err);
         goto cleanup;
     }
 
-    link_exit = bpf_program__attach(prog_exit);
-    if (libbpf_get_error(link_exit)) {
-        fprintf(stderr, "ERROR: failed to attach sys_exit tracepoint\n");
-        link_exit = NULL;
-        err = -1;
+    // Install kernel-side filters from CLI options
+    err = install_filters(skel, filter_pid_list, filter_pid_count, filter_cgroup_list,
+                          filter_cgroup_count, filter_syscall_list, filter_syscall_count,
+                          category_mask);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to install filters: %d\n", err);
         goto cleanup;
     }
 
-    fprintf(stderr, "BPF programs attached to tracepoints\n");
+    if (mode == MODE_AGGREGATE) {
+        // Aggregate mode: drain the per-(pid, syscall) map once per second.
+        // No ring buffer is in play, so only loader-side health is reported.
+        int agg_map_fd = bpf_map__fd(skel->maps.syscall_aggregates);
 
-    // Get ring buffer map file descriptor
-    map_fd = bpf_object__find_map_fd_by_name(obj, "events");
-    if (map_fd < 0) {
-        fprintf(stderr, "ERROR: failed to find ring buffer map\n");
-        err = map_fd;
-        goto cleanup;
+        self_telemetry_init(&selftel, "syscall", bpf_map__fd(skel->maps.prog_stats_map), -1);
+
+        fprintf(stderr, "Aggregating syscalls per (pid, syscall)... Press Ctrl+C to exit\n\n");
+
+        while (!exiting) {
+            sleep(1);
+            drain_aggregates(agg_map_fd);
+            wire_maybe_flush(&wire);
+            self_telemetry_maybe_emit(&selftel, &wire);
+        }
+
+        goto shutdown;
     }
 
+    // Get ring buffer map file descriptor
+    map_fd = bpf_map__fd(skel->maps.events);
+
+    // Track kernel-side drops and ring utilization
+    self_telemetry_init(&selftel, "syscall", bpf_map__fd(skel->maps.prog_stats_map), map_fd);
+
     // Set up ring buffer consumer
     rb = ring_buffer__new(map_fd, handle_event, NULL, NULL);
     if (!rb) {
@@ -169,28 +886,97 @@ int main(int argc, char **argv)
         goto cleanup;
     }
 
+    // Hand formatting and output off to a separate thread so the poll
+    // loop below does nothing but drain the kernel ring
+    if (ipc_ring_create(&event_queue, NULL, EVENT_QUEUE_SIZE) != 0) {
+        err = -1;
+        goto cleanup;
+    }
+
+    pthread_t serializer;
+    err = pthread_create(&serializer, NULL, serializer_main, NULL);
+    if (err) {
+        fprintf(stderr, "ERROR: failed to start serializer thread: %d\n", err);
+        ipc_ring_close(&event_queue);
+        goto cleanup;
+    }
+
     fprintf(stderr, "Tracing syscalls with latency >10ms... Press Ctrl+C to exit\n\n");
 
-    // Poll ring buffer for events
-    while (!exiting) {
-        err = ring_buffer__poll(rb, 100 /* timeout, ms */);
-        if (err == -EINTR) {
-            err = 0;
-            break;
+    if (latency_mode) {
+        // Latency mode: wait on the ring's epoll fd and consume the
+        // moment the kernel signals data, instead of on the poll tick
+        int rb_epoll_fd = ring_buffer__epoll_fd(rb);
+        struct epoll_event ev;
+
+        while (!exiting) {
+            int ready = epoll_wait(rb_epoll_fd, &ev, 1, 100);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    break;
+                }
+                fprintf(stderr, "ERROR: epoll_wait failed: %d\n", -errno);
+                err = -errno;
+                break;
+            }
+            if (ready > 0) {
+                err = ring_buffer__consume(rb);
+                if (err < 0) {
+                    fprintf(stderr, "ERROR: ring buffer consume failed: %d\n", err);
+                    break;
+                }
+                err = 0;
+            }
         }
-        if (err < 0) {
-            fprintf(stderr, "ERROR: ring buffer polling failed: %d\n", err);
-            break;
+    } else {
+        // Poll ring buffer for events
+        while (!exiting) {
+            err = ring_buffer__poll(rb, 100 /* timeout, ms */);
+            if (err == -EINTR) {
+                err = 0;
+                break;
+            }
+            if (err < 0) {
+                fprintf(stderr, "ERROR: ring buffer polling failed: %d\n", err);
+                break;
+            }
         }
     }
 
+    // Let the serializer drain what is queued, then join it before the
+    // wire writer is torn down
+    serializer_stop = 1;
+    pthread_join(serializer, NULL);
+    if (event_queue.dropped > 0) {
+        fprintf(stderr, "WARNING: %lu events dropped on full serializer queue\n",
+                (unsigned long)event_queue.dropped);
+    }
+    ipc_ring_close(&event_queue);
+
+shutdown:
+
     fprintf(stderr, "\nShutting down...\n");
 
 cleanup:
     ring_buffer__free(rb);
-    bpf_link__destroy(link_enter);
-    bpf_link__destroy(link_exit);
-    bpf_object__close(obj);
+    syscall_tracer_bpf__destroy(skel);
+    self_telemetry_destroy(&selftel);
+    if (ipc_active) {
+        if (ipc.dropped > 0) {
+            fprintf(stderr, "WARNING: %lu records dropped on full IPC ring\n",
+                    (unsigned long)ipc.dropped);
+        }
+        ipc_ring_close(&ipc);
+    }
+    if (spool_active) {
+        if (spool.recycled > 0) {
+            fprintf(stderr, "WARNING: %lu spool segments recycled before being consumed\n",
+                    (unsigned long)spool.recycled);
+        }
+        spool_writer_close(&spool);
+    }
+    hotpath_stats_close();
+    wire_writer_destroy(&wire);
 
     return err != 0;
 }
@@ -4,15 +4,112 @@
 // Network statistics scraper implementation
 
 #include "net_stats.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
+#include <errno.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #define PROC_NET_DEV "/proc/net/dev"
 #define PROC_NET_TCP "/proc/net/tcp"
 #define PROC_NET_TCP6 "/proc/net/tcp6"
 #define PROC_NET_SNMP "/proc/net/snmp"
 
+// Initial buffer sizes; scrape_source grows them on demand
+#define NET_DEV_BUF_SIZE 4096
+#define TCP_BUF_SIZE 65536
+#define SNMP_BUF_SIZE 4096
+
+int parse_net_dev_line(char *line, struct interface_stats *iface)
+{
+    char *colon = strchr(line, ':');
+    if (!colon) {
+        return -1;
+    }
+
+    // Parse interface name (before colon)
+    *colon = '\0';
+    char *name_start = line;
+    while (*name_start == ' ' || *name_start == '\t') {
+        name_start++;
+    }
+    strncpy(iface->name, name_start, sizeof(iface->name) - 1);
+    iface->name[sizeof(iface->name) - 1] = '\0';
+
+    // Parse statistics (after colon)
+    // Format: RX (bytes packets errs drop fifo frame compressed multicast)
+    //         TX (bytes packets errs drop fifo colls carrier compressed)
+    int ret = sscanf(colon + 1,
+                     "%lu %lu %lu %lu %*u %*u %*u %*u "
+                     "%lu %lu %lu %lu",
+                     &iface->rx_bytes, &iface->rx_packets, &iface->rx_errors, &iface->rx_drops,
+                     &iface->tx_bytes, &iface->tx_packets, &iface->tx_errors, &iface->tx_drops);
+
+    return (ret == 8) ? 0 : -1;
+}
+
+// Bump the counter matching one TCP_* state code from /proc/net/tcp{,6}
+static void count_tcp_state(unsigned int state, struct tcp_stats *stats)
+{
+    switch (state) {
+    case 0x01:
+        stats->established++;
+        break;
+    case 0x02:
+        stats->syn_sent++;
+        break;
+    case 0x03:
+        stats->syn_recv++;
+        break;
+    case 0x04:
+        stats->fin_wait1++;
+        break;
+    case 0x05:
+        stats->fin_wait2++;
+        break;
+    case 0x06:
+        stats->time_wait++;
+        break;
+    case 0x07:
+        stats->close++;
+        break;
+    case 0x08:
+        stats->close_wait++;
+        break;
+    case 0x09:
+        stats->last_ack++;
+        break;
+    case 0x0A:
+        stats->listen++;
+        break;
+    case 0x0B:
+        stats->closing++;
+        break;
+    }
+}
+
+// Extract RetransSegs (13th field) from the "Tcp:" data line of /proc/net/snmp
+static int parse_snmp_tcp_line(const char *line, struct tcp_retransmit_stats *stats)
+{
+    unsigned long long fields[13];
+    int ret = sscanf(line, "Tcp: %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                     &fields[0], &fields[1], &fields[2], &fields[3], &fields[4], &fields[5],
+                     &fields[6], &fields[7], &fields[8], &fields[9], &fields[10], &fields[11],
+                     &fields[12]);
+    if (ret < 13) {
+        return -1;
+    }
+    stats->retrans_segs = fields[12];
+    return 0;
+}
+
 int read_net_dev(struct interface_stats **interfaces, int *count)
 {
     FILE *fp;
@@ -45,30 +142,7 @@ int read_net_dev(struct interface_stats **interfaces, int *count)
     // Parse interface lines
     while (fgets(line, sizeof(line), fp)) {
         struct interface_stats iface;
-        char *colon = strchr(line, ':');
-        if (!colon) {
-            continue;
-        }
-
-        // Parse interface name (before colon)
-        *colon = '\0';
-        char *name_start = line;
-        while (*name_start == ' ' || *name_start == '\t') {
-            name_start++;
-        }
-        strncpy(iface.name, name_start, sizeof(iface.name) - 1);
-        iface.name[sizeof(iface.name) - 1] = '\0';
-
-        // Parse statistics (after colon)
-        // Format: RX (bytes packets errs drop fifo frame compressed multicast)
-        //         TX (bytes packets errs drop fifo colls carrier compressed)
-        int ret = sscanf(colon + 1,
-                         "%lu %lu %lu %lu %*u %*u %*u %*u "
-                         "%lu %lu %lu %lu",
-                         &iface.rx_bytes, &iface.rx_packets, &iface.rx_errors, &iface.rx_drops,
-                         &iface.tx_bytes, &iface.tx_packets, &iface.tx_errors, &iface.tx_drops);
-
-        if (ret != 8) {
+        if (parse_net_dev_line(line, &iface) != 0) {
             continue;
         }
 
@@ -95,6 +169,73 @@ int read_net_dev(struct interface_stats **interfaces, int *count)
     return 0;
 }
 
+int read_net_dev_cached(struct net_dev_cache *cache)
+{
+    if (!cache) {
+        return -1;
+    }
+
+    // Open /proc/net/dev once on first use; subsequent calls pread() the
+    // held-open fd instead of repeating the open/close cycle
+    if (!cache->source.path &&
+        scrape_source_open(&cache->source, PROC_NET_DEV, NET_DEV_BUF_SIZE) != 0) {
+        return -1;
+    }
+
+    if (scrape_source_read(&cache->source) != 0) {
+        return -1;
+    }
+
+    cache->count = 0;
+
+    char *cursor = cache->source.buf;
+    char *line;
+    int line_no = 0;
+    while ((line = scrape_next_line(&cursor)) != NULL) {
+        // Skip first two header lines
+        if (line_no++ < 2) {
+            continue;
+        }
+
+        struct interface_stats iface;
+        if (parse_net_dev_line(line, &iface) != 0) {
+            continue;
+        }
+
+        // Grow only when an interface appears; steady state is allocation-free
+        if (cache->count >= cache->capacity) {
+            int new_capacity = cache->capacity > 0 ? cache->capacity * 2 : 16;
+            struct interface_stats *new_list =
+                realloc(cache->interfaces, new_capacity * sizeof(struct interface_stats));
+            if (!new_list) {
+                return -1;
+            }
+            cache->interfaces = new_list;
+            cache->capacity = new_capacity;
+        }
+
+        cache->interfaces[cache->count++] = iface;
+    }
+
+    return 0;
+}
+
+void net_dev_cache_destroy(struct net_dev_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    if (cache->source.path) {
+        scrape_source_close(&cache->source);
+        cache->source.path = NULL;
+    }
+    free(cache->interfaces);
+    cache->interfaces = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+}
+
 int read_tcp_stats(struct tcp_stats *stats)
 {
     FILE *fp;
@@ -117,41 +258,7 @@ int read_tcp_stats(struct tcp_stats *stats)
             unsigned int state;
             // State is the 4th field (after sl, local_address, rem_address)
             if (sscanf(line, "%*u: %*x:%*x %*x:%*x %x", &state) == 1) {
-                switch (state) {
-                case 0x01:
-                    stats->established++;
-                    break;
-                case 0x02:
-                    stats->syn_sent++;
-                    break;
-                case 0x03:
-                    stats->syn_recv++;
-                    break;
-                case 0x04:
-                    stats->fin_wait1++;
-                    break;
-                case 0x05:
-                    stats->fin_wait2++;
-                    break;
-                case 0x06:
-                    stats->time_wait++;
-                    break;
-                case 0x07:
-                    stats->close++;
-                    break;
-                case 0x08:
-                    stats->close_wait++;
-                    break;
-                case 0x09:
-                    stats->last_ack++;
-                    break;
-                case 0x0A:
-                    stats->listen++;
-                    break;
-                case 0x0B:
-                    stats->closing++;
-                    break;
-                }
+                count_tcp_state(state, stats);
             }
         }
         fclose(fp);
@@ -167,41 +274,7 @@ int read_tcp_stats(struct tcp_stats *stats)
         while (fgets(line, sizeof(line), fp)) {
             unsigned int state;
             if (sscanf(line, "%*u: %*s %*s %x", &state) == 1) {
-                switch (state) {
-                case 0x01:
-                    stats->established++;
-                    break;
-                case 0x02:
-                    stats->syn_sent++;
-                    break;
-                case 0x03:
-                    stats->syn_recv++;
-                    break;
-                case 0x04:
-                    stats->fin_wait1++;
-                    break;
-                case 0x05:
-                    stats->fin_wait2++;
-                    break;
-                case 0x06:
-                    stats->time_wait++;
-                    break;
-                case 0x07:
-                    stats->close++;
-                    break;
-                case 0x08:
-                    stats->close_wait++;
-                    break;
-                case 0x09:
-                    stats->last_ack++;
-                    break;
-                case 0x0A:
-                    stats->listen++;
-                    break;
-                case 0x0B:
-                    stats->closing++;
-                    break;
-                }
+                count_tcp_state(state, stats);
             }
         }
         fclose(fp);
@@ -233,17 +306,8 @@ int read_tcp_retransmits(struct tcp_retransmit_stats *stats)
     while (fgets(line, sizeof(line), fp)) {
         if (sscanf(line, "%63s", label) == 1 && strcmp(label, "Tcp:") == 0) {
             if (found_header) {
-                // This is the data line
-                // Parse fields: we want RetransSegs which is the 13th field
-                unsigned long long fields[20];
-                int ret = sscanf(
-                    line, "Tcp: %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                    &fields[0], &fields[1], &fields[2], &fields[3], &fields[4], &fields[5],
-                    &fields[6], &fields[7], &fields[8], &fields[9], &fields[10], &fields[11],
-                    &fields[12]);
-                if (ret >= 13) {
-                    stats->retrans_segs = fields[12];
-                }
+                // This is the data line; we want RetransSegs (13th field)
+                parse_snmp_tcp_line(line, stats);
                 break;
             } else {
                 found_header = 1;
@@ -255,32 +319,278 @@ int read_tcp_retransmits(struct tcp_retransmit_stats *stats)
     return 0;
 }
 
+int tcp_diag_open(void)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        return -1;
+    }
+    return fd;
+}
+
+// Request an inet_diag dump for one address family and count the states.
+// Each socket comes back as one compact binary inet_diag_msg instead of a
+// formatted /proc/net/tcp line, so the kernel never renders the tens of
+// MB of text that a 200k-socket procfs read would.
+static int count_diag_family(int diag_fd, unsigned char family, struct tcp_stats *stats)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } request = {
+        .nlh =
+            {
+                .nlmsg_len = sizeof(request),
+                .nlmsg_type = SOCK_DIAG_BY_FAMILY,
+                .nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+            },
+        .req =
+            {
+                .sdiag_family = family,
+                .sdiag_protocol = IPPROTO_TCP,
+                .idiag_states = ~0U, // All states; we only want the distribution
+            },
+    };
+
+    if (send(diag_fd, &request, sizeof(request), 0) < 0) {
+        return -1;
+    }
+
+    char buf[32768];
+    for (;;) {
+        ssize_t len = recv(diag_fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (len == 0) {
+            return -1; // Truncated dump
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (size_t)len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                return -1;
+            }
+
+            struct inet_diag_msg *msg = NLMSG_DATA(nlh);
+            count_tcp_state(msg->idiag_state, stats);
+        }
+    }
+}
+
+int read_tcp_stats_diag(int diag_fd, struct tcp_stats *stats)
+{
+    if (diag_fd < 0 || !stats) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (count_diag_family(diag_fd, AF_INET, stats) != 0) {
+        return -1;
+    }
+    // IPv6 may be compiled out; a failed v6 dump still leaves valid v4
+    // counts, matching the fopen path's tolerance of a missing tcp6
+    count_diag_family(diag_fd, AF_INET6, stats);
+    return 0;
+}
+
+int tcp_scrape_cache_init(struct tcp_scrape_cache *cache)
+{
+    if (!cache) {
+        return -1;
+    }
+
+    cache->diag_fd = tcp_diag_open();
+
+    if (scrape_source_open(&cache->tcp, PROC_NET_TCP, TCP_BUF_SIZE) != 0) {
+        return -1;
+    }
+    // tcp6 is absent on IPv4-only hosts; treat that like the fopen path
+    // does and just skip it during reads
+    if (scrape_source_open(&cache->tcp6, PROC_NET_TCP6, TCP_BUF_SIZE) != 0) {
+        cache->tcp6.fd = -1;
+    }
+    if (scrape_source_open(&cache->snmp, PROC_NET_SNMP, SNMP_BUF_SIZE) != 0) {
+        scrape_source_close(&cache->tcp6);
+        scrape_source_close(&cache->tcp);
+        return -1;
+    }
+    return 0;
+}
+
+// Count connection states from one held-open /proc/net/tcp{,6} source
+static void count_tcp_source(struct scrape_source *src, const char *fmt, struct tcp_stats *stats)
+{
+    if (src->fd < 0 || scrape_source_read(src) != 0) {
+        return;
+    }
+
+    char *cursor = src->buf;
+    char *line;
+    int line_no = 0;
+    while ((line = scrape_next_line(&cursor)) != NULL) {
+        // Skip header
+        if (line_no++ < 1) {
+            continue;
+        }
+
+        unsigned int state;
+        if (sscanf(line, fmt, &state) == 1) {
+            count_tcp_state(state, stats);
+        }
+    }
+}
+
+int read_tcp_stats_cached(struct tcp_scrape_cache *cache, struct tcp_stats *stats)
+{
+    if (!cache || !stats) {
+        return -1;
+    }
+
+    // Prefer the sock_diag dump; on failure fall back to the procfs
+    // parsers for this tick and close the socket for good
+    if (cache->diag_fd >= 0) {
+        if (read_tcp_stats_diag(cache->diag_fd, stats) == 0) {
+            return 0;
+        }
+        fprintf(stderr, "WARNING: sock_diag dump failed, falling back to /proc/net/tcp\n");
+        close(cache->diag_fd);
+        cache->diag_fd = -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    count_tcp_source(&cache->tcp, "%*u: %*x:%*x %*x:%*x %x", stats);
+    count_tcp_source(&cache->tcp6, "%*u: %*s %*s %x", stats);
+    return 0;
+}
+
+int read_tcp_retransmits_cached(struct tcp_scrape_cache *cache, struct tcp_retransmit_stats *stats)
+{
+    char label[64];
+
+    if (!cache || !stats) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (scrape_source_read(&cache->snmp) != 0) {
+        return -1;
+    }
+
+    // Find the "Tcp:" data line (second line with "Tcp:" prefix)
+    char *cursor = cache->snmp.buf;
+    char *line;
+    int found_header = 0;
+    while ((line = scrape_next_line(&cursor)) != NULL) {
+        if (sscanf(line, "%63s", label) == 1 && strcmp(label, "Tcp:") == 0) {
+            if (found_header) {
+                parse_snmp_tcp_line(line, stats);
+                break;
+            }
+            found_header = 1;
+        }
+    }
+
+    return 0;
+}
+
+void tcp_scrape_cache_destroy(struct tcp_scrape_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    if (cache->diag_fd >= 0) {
+        close(cache->diag_fd);
+        cache->diag_fd = -1;
+    }
+    scrape_source_close(&cache->tcp);
+    scrape_source_close(&cache->tcp6);
+    scrape_source_close(&cache->snmp);
+}
+
 void print_interface_stats_json(const struct interface_stats *iface, uint64_t timestamp)
 {
-    printf("{\"timestamp\":%lu,\"type\":\"net_interface\",\"interface\":\"%s\",\"data\":{\"rx_"
-           "bytes\":%lu,\"rx_packets\":%lu,\"rx_errors\":%lu,\"rx_drops\":%lu,\"tx_bytes\":%lu,"
-           "\"tx_packets\":%lu,\"tx_errors\":%lu,\"tx_drops\":%lu}}\n",
-           timestamp, iface->name, iface->rx_bytes, iface->rx_packets, iface->rx_errors,
-           iface->rx_drops, iface->tx_bytes, iface->tx_packets, iface->tx_errors, iface->tx_drops);
-    fflush(stdout);
+    char line[512];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "net_interface");
+    json_str(&jw, "interface", iface->name);
+    json_obj_begin(&jw, "data");
+    json_u64(&jw, "rx_bytes", iface->rx_bytes);
+    json_u64(&jw, "rx_packets", iface->rx_packets);
+    json_u64(&jw, "rx_errors", iface->rx_errors);
+    json_u64(&jw, "rx_drops", iface->rx_drops);
+    json_u64(&jw, "tx_bytes", iface->tx_bytes);
+    json_u64(&jw, "tx_packets", iface->tx_packets);
+    json_u64(&jw, "tx_errors", iface->tx_errors);
+    json_u64(&jw, "tx_drops", iface->tx_drops);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
 
 void print_tcp_stats_json(const struct tcp_stats *stats, uint64_t timestamp)
 {
-    printf("{\"timestamp\":%lu,\"type\":\"tcp_stats\",\"data\":{\"established\":%u,\"syn_sent\":%u,"
-           "\"syn_recv\":%u,\"fin_wait1\":%u,\"fin_wait2\":%u,\"time_wait\":%u,\"close\":%u,"
-           "\"close_wait\":%u,\"last_ack\":%u,\"listen\":%u,\"closing\":%u}}\n",
-           timestamp, stats->established, stats->syn_sent, stats->syn_recv, stats->fin_wait1,
-           stats->fin_wait2, stats->time_wait, stats->close, stats->close_wait, stats->last_ack,
-           stats->listen, stats->closing);
-    fflush(stdout);
+    char line[512];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "tcp_stats");
+    json_obj_begin(&jw, "data");
+    json_u64(&jw, "established", stats->established);
+    json_u64(&jw, "syn_sent", stats->syn_sent);
+    json_u64(&jw, "syn_recv", stats->syn_recv);
+    json_u64(&jw, "fin_wait1", stats->fin_wait1);
+    json_u64(&jw, "fin_wait2", stats->fin_wait2);
+    json_u64(&jw, "time_wait", stats->time_wait);
+    json_u64(&jw, "close", stats->close);
+    json_u64(&jw, "close_wait", stats->close_wait);
+    json_u64(&jw, "last_ack", stats->last_ack);
+    json_u64(&jw, "listen", stats->listen);
+    json_u64(&jw, "closing", stats->closing);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
 
 void print_tcp_retransmit_json(const struct tcp_retransmit_stats *stats, uint64_t timestamp)
 {
-    printf("{\"timestamp\":%lu,\"type\":\"tcp_retransmits\",\"data\":{\"retrans_segs\":%lu}}\n",
-           timestamp, stats->retrans_segs);
-    fflush(stdout);
+    char line[128];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "tcp_retransmits");
+    json_obj_begin(&jw, "data");
+    json_u64(&jw, "retrans_segs", stats->retrans_segs);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
 
 void free_interface_stats(struct interface_stats *interfaces, int count)
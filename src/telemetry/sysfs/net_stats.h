@@ -6,6 +6,7 @@
 #ifndef NET_STATS_H
 #define NET_STATS_H
 
+#include "scrape_source.h"
 #include <stdint.h>
 
 // Per-interface statistics from /proc/net/dev
@@ -41,6 +42,14 @@ struct tcp_retransmit_stats {
     uint64_t retrans_segs; // Total TCP segments retransmitted
 };
 
+/**
+ * Parse one /proc/net/dev interface line (modified in place)
+ * @param line The interface line ("eth0: 123 456 ...")
+ * @param iface Output structure for one interface
+ * @return 0 on success, -1 on parse failure
+ */
+int parse_net_dev_line(char *line, struct interface_stats *iface);
+
 /**
  * Read network interface statistics from /proc/net/dev
  * @param interfaces Output array of interface stats (caller must free)
@@ -91,4 +100,81 @@ void print_tcp_retransmit_json(const struct tcp_retransmit_stats *stats, uint64_
  */
 void free_interface_stats(struct interface_stats *interfaces, int count);
 
+// Reusable interface list for periodic scrapers: the array is grown on
+// demand and kept across scrapes instead of being malloc/freed every second
+struct net_dev_cache {
+    struct scrape_source source; // Held-open /proc/net/dev (lazily opened)
+    struct interface_stats *interfaces;
+    int count;
+    int capacity;
+};
+
+/**
+ * Read /proc/net/dev into a reusable cache (allocation-free steady state)
+ * @param cache Cache holding the interface array across calls (zero-init once)
+ * @return 0 on success, -1 on error
+ */
+int read_net_dev_cached(struct net_dev_cache *cache);
+
+/**
+ * Free the cached interface array
+ * @param cache Cache to tear down
+ */
+void net_dev_cache_destroy(struct net_dev_cache *cache);
+
+// Persistently open TCP sources (/proc/net/tcp, tcp6, snmp) for periodic
+// scrapers: opened once at startup, re-read via pread() every tick
+struct tcp_scrape_cache {
+    struct scrape_source tcp;
+    struct scrape_source tcp6;
+    struct scrape_source snmp;
+    int diag_fd; // NETLINK_SOCK_DIAG socket, -1 when unavailable
+};
+
+/**
+ * Open the TCP procfs sources once for repeated scraping
+ * @param cache Cache to initialize
+ * @return 0 on success, -1 on error
+ */
+int tcp_scrape_cache_init(struct tcp_scrape_cache *cache);
+
+/**
+ * Re-read TCP connection states, preferring the sock_diag backend
+ * Uses the NETLINK_SOCK_DIAG dump (compact binary records, no procfs
+ * text generation) when available, falling back to the /proc/net/tcp
+ * parsers otherwise.
+ * @param cache Cache initialized with tcp_scrape_cache_init()
+ * @param stats Output structure for TCP connection stats
+ * @return 0 on success, -1 on error
+ */
+int read_tcp_stats_cached(struct tcp_scrape_cache *cache, struct tcp_stats *stats);
+
+/**
+ * Open a NETLINK_SOCK_DIAG socket for TCP state dumps
+ * @return Socket fd on success, -1 when sock_diag is unavailable
+ */
+int tcp_diag_open(void);
+
+/**
+ * Count TCP connection states via an inet_diag dump (IPv4 + IPv6)
+ * @param diag_fd Socket from tcp_diag_open()
+ * @param stats Output structure for TCP connection stats
+ * @return 0 on success, -1 on error (caller should fall back to procfs)
+ */
+int read_tcp_stats_diag(int diag_fd, struct tcp_stats *stats);
+
+/**
+ * Re-read TCP retransmit statistics through the held-open fd
+ * @param cache Cache initialized with tcp_scrape_cache_init()
+ * @param stats Output structure for retransmit stats
+ * @return 0 on success, -1 on error
+ */
+int read_tcp_retransmits_cached(struct tcp_scrape_cache *cache, struct tcp_retransmit_stats *stats);
+
+/**
+ * Close the held-open fds and free the read buffers
+ * @param cache Cache to tear down
+ */
+void tcp_scrape_cache_destroy(struct tcp_scrape_cache *cache);
+
 #endif // NET_STATS_H
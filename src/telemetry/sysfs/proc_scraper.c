@@ -4,18 +4,75 @@
 // Procfs scraper implementation
 
 #include "proc_scraper.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
 #include <stdio.h>
 #include <string.h>
 
 #define PROC_MEMINFO "/proc/meminfo"
 #define PROC_LOADAVG "/proc/loadavg"
 
+// Initial buffer sizes; scrape_source grows them on demand
+#define MEMINFO_BUF_SIZE 4096
+#define LOADAVG_BUF_SIZE 256
+
+void parse_meminfo_line(const char *line, struct meminfo_metrics *metrics)
+{
+    char key[64];
+    uint64_t value;
+
+    if (sscanf(line, "%63s %lu", key, &value) != 2) {
+        return;
+    }
+
+    // Remove trailing colon from key
+    size_t len = strlen(key);
+    if (len > 0 && key[len - 1] == ':') {
+        key[len - 1] = '\0';
+    }
+
+    if (strcmp(key, "MemTotal") == 0) {
+        metrics->mem_total_kb = value;
+    } else if (strcmp(key, "MemFree") == 0) {
+        metrics->mem_free_kb = value;
+    } else if (strcmp(key, "MemAvailable") == 0) {
+        metrics->mem_available_kb = value;
+    } else if (strcmp(key, "Buffers") == 0) {
+        metrics->buffers_kb = value;
+    } else if (strcmp(key, "Cached") == 0) {
+        metrics->cached_kb = value;
+    } else if (strcmp(key, "SwapTotal") == 0) {
+        metrics->swap_total_kb = value;
+    } else if (strcmp(key, "SwapFree") == 0) {
+        metrics->swap_free_kb = value;
+    } else if (strcmp(key, "Active") == 0) {
+        metrics->active_kb = value;
+    } else if (strcmp(key, "Inactive") == 0) {
+        metrics->inactive_kb = value;
+    } else if (strcmp(key, "Dirty") == 0) {
+        metrics->dirty_kb = value;
+    } else if (strcmp(key, "Writeback") == 0) {
+        metrics->writeback_kb = value;
+    }
+}
+
+int parse_loadavg_line(const char *line, struct loadavg_metrics *metrics)
+{
+    int ret = sscanf(line, "%lf %lf %lf %u/%u %u", &metrics->load_1min, &metrics->load_5min,
+                     &metrics->load_15min, &metrics->running_processes, &metrics->total_processes,
+                     &metrics->last_pid);
+
+    if (ret != 6) {
+        fprintf(stderr, "ERROR: failed to parse %s (got %d fields)\n", PROC_LOADAVG, ret);
+        return -1;
+    }
+    return 0;
+}
+
 int read_proc_meminfo(struct meminfo_metrics *metrics)
 {
     FILE *fp;
     char line[256];
-    char key[64];
-    uint64_t value;
 
     if (!metrics) {
         return -1;
@@ -30,39 +87,8 @@ int read_proc_meminfo(struct meminfo_metrics *metrics)
         return -1;
     }
 
-    // Parse each line: "Key: value kB"
     while (fgets(line, sizeof(line), fp)) {
-        if (sscanf(line, "%63s %lu", key, &value) == 2) {
-            // Remove trailing colon from key
-            size_t len = strlen(key);
-            if (len > 0 && key[len - 1] == ':') {
-                key[len - 1] = '\0';
-            }
-
-            if (strcmp(key, "MemTotal") == 0) {
-                metrics->mem_total_kb = value;
-            } else if (strcmp(key, "MemFree") == 0) {
-                metrics->mem_free_kb = value;
-            } else if (strcmp(key, "MemAvailable") == 0) {
-                metrics->mem_available_kb = value;
-            } else if (strcmp(key, "Buffers") == 0) {
-                metrics->buffers_kb = value;
-            } else if (strcmp(key, "Cached") == 0) {
-                metrics->cached_kb = value;
-            } else if (strcmp(key, "SwapTotal") == 0) {
-                metrics->swap_total_kb = value;
-            } else if (strcmp(key, "SwapFree") == 0) {
-                metrics->swap_free_kb = value;
-            } else if (strcmp(key, "Active") == 0) {
-                metrics->active_kb = value;
-            } else if (strcmp(key, "Inactive") == 0) {
-                metrics->inactive_kb = value;
-            } else if (strcmp(key, "Dirty") == 0) {
-                metrics->dirty_kb = value;
-            } else if (strcmp(key, "Writeback") == 0) {
-                metrics->writeback_kb = value;
-            }
-        }
+        parse_meminfo_line(line, metrics);
     }
 
     fclose(fp);
@@ -86,15 +112,8 @@ int read_proc_loadavg(struct loadavg_metrics *metrics)
         return -1;
     }
 
-    // Format: "0.52 0.58 0.59 3/602 29369"
-    // load1 load5 load15 running/total last_pid
     if (fgets(line, sizeof(line), fp)) {
-        int ret = sscanf(line, "%lf %lf %lf %u/%u %u", &metrics->load_1min, &metrics->load_5min,
-                         &metrics->load_15min, &metrics->running_processes,
-                         &metrics->total_processes, &metrics->last_pid);
-
-        if (ret != 6) {
-            fprintf(stderr, "ERROR: failed to parse %s (got %d fields)\n", PROC_LOADAVG, ret);
+        if (parse_loadavg_line(line, metrics) != 0) {
             fclose(fp);
             return -1;
         }
@@ -108,24 +127,116 @@ int read_proc_loadavg(struct loadavg_metrics *metrics)
     return 0;
 }
 
+int proc_scrape_cache_init(struct proc_scrape_cache *cache)
+{
+    if (!cache) {
+        return -1;
+    }
+
+    if (scrape_source_open(&cache->meminfo, PROC_MEMINFO, MEMINFO_BUF_SIZE) != 0) {
+        return -1;
+    }
+    if (scrape_source_open(&cache->loadavg, PROC_LOADAVG, LOADAVG_BUF_SIZE) != 0) {
+        scrape_source_close(&cache->meminfo);
+        return -1;
+    }
+    return 0;
+}
+
+int read_proc_meminfo_cached(struct proc_scrape_cache *cache, struct meminfo_metrics *metrics)
+{
+    if (!cache || !metrics) {
+        return -1;
+    }
+
+    memset(metrics, 0, sizeof(*metrics));
+
+    if (scrape_source_read(&cache->meminfo) != 0) {
+        return -1;
+    }
+
+    char *cursor = cache->meminfo.buf;
+    char *line;
+    while ((line = scrape_next_line(&cursor)) != NULL) {
+        parse_meminfo_line(line, metrics);
+    }
+    return 0;
+}
+
+int read_proc_loadavg_cached(struct proc_scrape_cache *cache, struct loadavg_metrics *metrics)
+{
+    if (!cache || !metrics) {
+        return -1;
+    }
+
+    memset(metrics, 0, sizeof(*metrics));
+
+    if (scrape_source_read(&cache->loadavg) != 0) {
+        return -1;
+    }
+
+    return parse_loadavg_line(cache->loadavg.buf, metrics);
+}
+
+void proc_scrape_cache_destroy(struct proc_scrape_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    scrape_source_close(&cache->meminfo);
+    scrape_source_close(&cache->loadavg);
+}
+
 void print_meminfo_json(const struct meminfo_metrics *metrics, uint64_t timestamp)
 {
-    printf("{\"timestamp\":%lu,\"type\":\"meminfo\",\"data\":{\"mem_total_kb\":%lu,\"mem_free_kb\":"
-           "%lu,\"mem_available_kb\":%lu,\"buffers_kb\":%lu,\"cached_kb\":%lu,\"swap_total_kb\":%"
-           "lu,\"swap_free_kb\":%lu,\"active_kb\":%lu,\"inactive_kb\":%lu,\"dirty_kb\":%lu,"
-           "\"writeback_kb\":%lu}}\n",
-           timestamp, metrics->mem_total_kb, metrics->mem_free_kb, metrics->mem_available_kb,
-           metrics->buffers_kb, metrics->cached_kb, metrics->swap_total_kb, metrics->swap_free_kb,
-           metrics->active_kb, metrics->inactive_kb, metrics->dirty_kb, metrics->writeback_kb);
-    fflush(stdout);
+    char line[512];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "meminfo");
+    json_obj_begin(&jw, "data");
+    json_u64(&jw, "mem_total_kb", metrics->mem_total_kb);
+    json_u64(&jw, "mem_free_kb", metrics->mem_free_kb);
+    json_u64(&jw, "mem_available_kb", metrics->mem_available_kb);
+    json_u64(&jw, "buffers_kb", metrics->buffers_kb);
+    json_u64(&jw, "cached_kb", metrics->cached_kb);
+    json_u64(&jw, "swap_total_kb", metrics->swap_total_kb);
+    json_u64(&jw, "swap_free_kb", metrics->swap_free_kb);
+    json_u64(&jw, "active_kb", metrics->active_kb);
+    json_u64(&jw, "inactive_kb", metrics->inactive_kb);
+    json_u64(&jw, "dirty_kb", metrics->dirty_kb);
+    json_u64(&jw, "writeback_kb", metrics->writeback_kb);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
 
 void print_loadavg_json(const struct loadavg_metrics *metrics, uint64_t timestamp)
 {
-    printf(
-        "{\"timestamp\":%lu,\"type\":\"loadavg\",\"data\":{\"load_1min\":%.2f,\"load_5min\":%.2f,"
-        "\"load_15min\":%.2f,\"running_processes\":%u,\"total_processes\":%u,\"last_pid\":%u}}\n",
-        timestamp, metrics->load_1min, metrics->load_5min, metrics->load_15min,
-        metrics->running_processes, metrics->total_processes, metrics->last_pid);
-    fflush(stdout);
+    char line[256];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "loadavg");
+    json_obj_begin(&jw, "data");
+    json_double(&jw, "load_1min", metrics->load_1min, 2);
+    json_double(&jw, "load_5min", metrics->load_5min, 2);
+    json_double(&jw, "load_15min", metrics->load_15min, 2);
+    json_u64(&jw, "running_processes", metrics->running_processes);
+    json_u64(&jw, "total_processes", metrics->total_processes);
+    json_u64(&jw, "last_pid", metrics->last_pid);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
@@ -6,6 +6,7 @@
 #ifndef PROC_SCRAPER_H
 #define PROC_SCRAPER_H
 
+#include "scrape_source.h"
 #include <stdint.h>
 
 // Memory information from /proc/meminfo
@@ -33,6 +34,21 @@ struct loadavg_metrics {
     uint32_t last_pid;
 };
 
+/**
+ * Apply one "Key: value kB" line from /proc/meminfo to metrics
+ * @param line One meminfo line
+ * @param metrics Metrics structure to update
+ */
+void parse_meminfo_line(const char *line, struct meminfo_metrics *metrics);
+
+/**
+ * Parse one /proc/loadavg line ("0.52 0.58 0.59 3/602 29369")
+ * @param line The loadavg line
+ * @param metrics Output structure for load average metrics
+ * @return 0 on success, -1 on parse failure
+ */
+int parse_loadavg_line(const char *line, struct loadavg_metrics *metrics);
+
 /**
  * Read and parse /proc/meminfo
  * @param metrics Output structure for memory metrics
@@ -61,4 +77,40 @@ void print_meminfo_json(const struct meminfo_metrics *metrics, uint64_t timestam
  */
 void print_loadavg_json(const struct loadavg_metrics *metrics, uint64_t timestamp);
 
+// Persistently open /proc sources for periodic scrapers: each file is
+// opened once at startup and re-read via pread() every tick
+struct proc_scrape_cache {
+    struct scrape_source meminfo;
+    struct scrape_source loadavg;
+};
+
+/**
+ * Open /proc/meminfo and /proc/loadavg once for repeated scraping
+ * @param cache Cache to initialize
+ * @return 0 on success, -1 on error
+ */
+int proc_scrape_cache_init(struct proc_scrape_cache *cache);
+
+/**
+ * Re-read and parse /proc/meminfo through the held-open fd
+ * @param cache Cache initialized with proc_scrape_cache_init()
+ * @param metrics Output structure for memory metrics
+ * @return 0 on success, -1 on error
+ */
+int read_proc_meminfo_cached(struct proc_scrape_cache *cache, struct meminfo_metrics *metrics);
+
+/**
+ * Re-read and parse /proc/loadavg through the held-open fd
+ * @param cache Cache initialized with proc_scrape_cache_init()
+ * @param metrics Output structure for load average metrics
+ * @return 0 on success, -1 on error
+ */
+int read_proc_loadavg_cached(struct proc_scrape_cache *cache, struct loadavg_metrics *metrics);
+
+/**
+ * Close the held-open fds and free the read buffers
+ * @param cache Cache to tear down
+ */
+void proc_scrape_cache_destroy(struct proc_scrape_cache *cache);
+
 #endif // PROC_SCRAPER_H
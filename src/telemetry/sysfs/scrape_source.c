@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Persistent-fd scraping core implementation
+
+#include "scrape_source.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int scrape_source_open(struct scrape_source *src, const char *path, size_t capacity)
+{
+    if (!src || !path || capacity == 0) {
+        return -1;
+    }
+
+    src->path = path;
+    src->len = 0;
+
+    src->buf = malloc(capacity);
+    if (!src->buf) {
+        src->fd = -1;
+        src->capacity = 0;
+        return -1;
+    }
+    src->capacity = capacity;
+
+    src->fd = open(path, O_RDONLY);
+    if (src->fd < 0) {
+        fprintf(stderr, "ERROR: failed to open %s\n", path);
+        free(src->buf);
+        src->buf = NULL;
+        src->capacity = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+int scrape_source_read(struct scrape_source *src)
+{
+    if (!src || src->fd < 0 || !src->buf) {
+        return -1;
+    }
+
+    // Procfs seq files support positional reads, so the whole file is
+    // pulled through pread() without ever touching the fd's own offset.
+    // Doubling on a full buffer only happens the first time a source
+    // outgrows its initial size (e.g., /proc/net/tcp on busy hosts).
+    size_t off = 0;
+    for (;;) {
+        if (off + 1 >= src->capacity) {
+            size_t new_capacity = src->capacity * 2;
+            char *new_buf = realloc(src->buf, new_capacity);
+            if (!new_buf) {
+                return -1;
+            }
+            src->buf = new_buf;
+            src->capacity = new_capacity;
+        }
+
+        ssize_t n = pread(src->fd, src->buf + off, src->capacity - off - 1, (off_t)off);
+        if (n < 0) {
+            fprintf(stderr, "ERROR: failed to read %s\n", src->path);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        off += (size_t)n;
+    }
+
+    src->buf[off] = '\0';
+    src->len = off;
+    return 0;
+}
+
+char *scrape_next_line(char **cursor)
+{
+    if (!cursor || !*cursor || **cursor == '\0') {
+        return NULL;
+    }
+
+    char *line = *cursor;
+    char *nl = line;
+    while (*nl && *nl != '\n') {
+        nl++;
+    }
+
+    if (*nl == '\n') {
+        *nl = '\0';
+        *cursor = nl + 1;
+    } else {
+        *cursor = nl; // Last line without trailing newline
+    }
+
+    return line;
+}
+
+void scrape_source_close(struct scrape_source *src)
+{
+    if (!src) {
+        return;
+    }
+
+    if (src->fd >= 0) {
+        close(src->fd);
+        src->fd = -1;
+    }
+    free(src->buf);
+    src->buf = NULL;
+    src->capacity = 0;
+    src->len = 0;
+}
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 KernelSight AI
+//
+// Persistent-fd scraping core for /proc and /sys sources
+//
+// Procfs files can be held open and re-read with pread() at offset 0,
+// skipping path resolution and stdio setup on every poll. A scrape_source
+// bundles one such fd with a preallocated buffer that grows on demand and
+// is reused across reads, so the steady-state cost of a poll is a handful
+// of pread() calls and zero allocations.
+
+#ifndef SCRAPE_SOURCE_H
+#define SCRAPE_SOURCE_H
+
+#include <stddef.h>
+
+// One persistently open metrics source
+struct scrape_source {
+    const char *path; // Source path (static string; identifies the source)
+    int fd;           // Held-open file descriptor (-1 if open failed)
+    char *buf;        // Preallocated read buffer, NUL-terminated after read
+    size_t capacity;  // Buffer capacity in bytes
+    size_t len;       // Bytes read by the last scrape_source_read()
+};
+
+/**
+ * Open a source once and preallocate its read buffer
+ * @param src Source to initialize
+ * @param path File to hold open (e.g., "/proc/meminfo")
+ * @param capacity Initial buffer size; grows automatically if too small
+ * @return 0 on success, -1 on error
+ */
+int scrape_source_open(struct scrape_source *src, const char *path, size_t capacity);
+
+/**
+ * Re-read the whole source into the persistent buffer via pread()
+ * The buffer is NUL-terminated; src->len holds the byte count.
+ * @param src Source opened with scrape_source_open()
+ * @return 0 on success, -1 on error
+ */
+int scrape_source_read(struct scrape_source *src);
+
+/**
+ * Return the next line from a read buffer, NUL-terminating it in place
+ * @param cursor In/out pointer into src->buf; start with cursor = src->buf
+ * @return Pointer to the line, or NULL when the buffer is exhausted
+ */
+char *scrape_next_line(char **cursor);
+
+/**
+ * Close the fd and free the buffer
+ * @param src Source to tear down
+ */
+void scrape_source_close(struct scrape_source *src);
+
+#endif // SCRAPE_SOURCE_H
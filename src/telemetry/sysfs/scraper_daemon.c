@@ -2,26 +2,57 @@
 // Copyright (c) 2025 KernelSight AI
 //
 // Scraper daemon: periodically polls /proc and /sys for metrics
-// Emits JSON events to stdout every 1 second
+// Emits JSON events to stdout on a per-metric-class schedule
 
+#include "../common/hotpath.h"
+#include "../common/realtime.h"
+#include "../common/wire.h"
 #include "net_stats.h"
 #include "proc_scraper.h"
 #include "sysfs_scraper.h"
+#include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <unistd.h>
 
 
 static volatile sig_atomic_t running = 1;
 
+// Batched output writer; the print_*_json() helpers route through it via
+// the wire line sink, so one tick's records flush (and compress) together
+static struct wire_writer wire;
+
+// Cycle histogram over each tick's due scrapes (--stats-socket / USDT)
+static struct hotpath_hist scrape_hist;
+
+// Runtime interval adjustment: SIGUSR1 halves every interval (incident
+// mode, 50ms floor), SIGUSR2 restores the configured cadence. Handlers
+// only set flags; the scheduler loop applies them between ticks.
+static volatile sig_atomic_t speed_up;
+static volatile sig_atomic_t restore_rate;
+
 static void sig_handler(int sig)
 {
     (void)sig; // Unused
     running = 0;
 }
 
+static void sigusr1_handler(int sig)
+{
+    (void)sig; // Unused
+    speed_up = 1;
+}
+
+static void sigusr2_handler(int sig)
+{
+    (void)sig; // Unused
+    restore_rate = 1;
+}
+
 /**
  * Get current timestamp in nanoseconds since epoch
  */
@@ -32,92 +63,549 @@ static uint64_t get_timestamp_ns(void)
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
-int main(int argc, char **argv)
+/**
+ * Monotonic clock for scheduling deadlines; immune to wall-clock steps
+ */
+static uint64_t get_monotonic_ns(void)
 {
-    struct meminfo_metrics meminfo;
-    struct loadavg_metrics loadavg;
-    char **block_devices = NULL;
-    int block_device_count = 0;
-    uint64_t timestamp;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
 
-    (void)argc; // Unused
-    (void)argv; // Unused
+// ============================================================================
+// Metric class scheduler
+// ============================================================================
 
-    // Set up signal handlers for graceful shutdown
-    signal(SIGINT, sig_handler);
-    signal(SIGTERM, sig_handler);
+// Each class of scrapes runs on its own interval so cheap, high-value
+// metrics (meminfo, loadavg) can poll finer than expensive ones (the
+// /proc/net/tcp state scan). Deadlines are absolute CLOCK_MONOTONIC
+// values advanced by the interval, so scrape time does not accumulate
+// as drift the way a fixed sleep(1) did.
 
-    fprintf(stderr, "KernelSight AI - Sysfs/Procfs Scraper Daemon\n");
-    fprintf(stderr, "Polling every 1 second. Press Ctrl+C to exit.\n");
-    fprintf(stderr, "JSON output will be written to stdout.\n\n");
+enum metric_class {
+    CLASS_MEMINFO,
+    CLASS_LOADAVG,
+    CLASS_BLOCK,
+    CLASS_NET,
+    CLASS_TCP,
+    CLASS_RETRANS,
+    CLASS_COUNT,
+};
 
-    while (running) {
-        timestamp = get_timestamp_ns();
+#define DEFAULT_INTERVAL_MS 1000
+#define MIN_INTERVAL_MS 50
+
+struct metric_sched {
+    const char *name;
+    uint64_t interval_ns;   // Active interval
+    uint64_t configured_ns; // CLI-configured interval (SIGUSR2 restores this)
+    uint64_t deadline_ns;   // Next run, absolute CLOCK_MONOTONIC
+};
+
+static struct metric_sched sched_table[CLASS_COUNT] = {
+    [CLASS_MEMINFO] = {.name = "meminfo"},
+    [CLASS_LOADAVG] = {.name = "loadavg"},
+    [CLASS_BLOCK]   = {.name = "block"},
+    [CLASS_NET]     = {.name = "net"},
+    [CLASS_TCP]     = {.name = "tcp"},
+    [CLASS_RETRANS] = {.name = "retrans"},
+};
+
+/**
+ * Parse a "class=ms" interval spec from the command line.
+ * Returns 0 on success, -1 on an unknown class or bad interval.
+ */
+static int parse_interval_spec(const char *spec)
+{
+    const char *eq = strchr(spec, '=');
+    long ms;
+
+    if (!eq || eq == spec) {
+        fprintf(stderr, "ERROR: interval spec must be CLASS=MS, got '%s'\n", spec);
+        return -1;
+    }
+
+    ms = atol(eq + 1);
+    if (ms < MIN_INTERVAL_MS) {
+        fprintf(stderr, "ERROR: interval must be at least %dms, got '%s'\n",
+                MIN_INTERVAL_MS, eq + 1);
+        return -1;
+    }
+
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        if (strncmp(sched_table[i].name, spec, eq - spec) == 0 &&
+            sched_table[i].name[eq - spec] == '\0') {
+            sched_table[i].configured_ns = (uint64_t)ms * 1000000ULL;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "ERROR: unknown metric class '%.*s' (classes:", (int)(eq - spec), spec);
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        fprintf(stderr, " %s", sched_table[i].name);
+    }
+    fprintf(stderr, ")\n");
+    return -1;
+}
 
-        // Collect and emit meminfo metrics
-        if (read_proc_meminfo(&meminfo) == 0) {
-            print_meminfo_json(&meminfo, timestamp);
+// ============================================================================
+// Delta suppression
+// ============================================================================
+
+// Opt-in (--delta): remember the previous sample per record key and skip
+// emission when nothing changed. Idle hosts otherwise re-emit identical
+// rows forever (an idle interface never moves its counters). A periodic
+// keyframe per record still ships so a consumer that joins or resyncs
+// mid-stream sees every key within one keyframe interval; no information
+// is lost because every change is still emitted.
+
+#define DEFAULT_KEYFRAME_SEC 60
+#define DELTA_MAX_DEVICES 64
+
+static int delta_mode;
+static uint64_t keyframe_interval_ns =
+    (uint64_t)DEFAULT_KEYFRAME_SEC * 1000000000ULL;
+
+struct delta_entry {
+    uint64_t last_emit_ns; // CLOCK_MONOTONIC of the last emission
+    int valid;
+};
+
+/**
+ * Decide whether a record must be emitted; prev is updated when it is.
+ * Emits when delta mode is off, the sample changed, or the per-record
+ * keyframe interval has elapsed.
+ */
+static int delta_should_emit(struct delta_entry *e, void *prev, const void *cur,
+                             size_t len, uint64_t now)
+{
+    if (!delta_mode) {
+        return 1;
+    }
+    if (e->valid && memcmp(prev, cur, len) == 0 &&
+        now - e->last_emit_ns < keyframe_interval_ns) {
+        return 0;
+    }
+    memcpy(prev, cur, len);
+    e->valid = 1;
+    e->last_emit_ns = now;
+    return 1;
+}
+
+// Singleton records keep one previous sample each
+static struct delta_entry d_meminfo_e;
+static struct meminfo_metrics d_meminfo_prev;
+static struct delta_entry d_loadavg_e;
+static struct loadavg_metrics d_loadavg_prev;
+static struct delta_entry d_tcp_e;
+static struct tcp_stats d_tcp_prev;
+static struct delta_entry d_retrans_e;
+static struct tcp_retransmit_stats d_retrans_prev;
+
+// Per-device records are keyed by name
+struct delta_block_slot {
+    char name[32];
+    struct delta_entry e;
+    struct block_stats prev;
+};
+
+static struct delta_block_slot d_block[DELTA_MAX_DEVICES];
+static int d_block_count;
+
+struct delta_net_slot {
+    char name[16];
+    struct delta_entry e;
+    struct interface_stats prev;
+};
+
+static struct delta_net_slot d_net[DELTA_MAX_DEVICES];
+static int d_net_count;
+
+/**
+ * Find or create the per-device delta slot; NULL when the table is full
+ * (the caller then emits unconditionally, trading volume for safety)
+ */
+static struct delta_block_slot *delta_block_lookup(const char *name)
+{
+    for (int i = 0; i < d_block_count; i++) {
+        if (strcmp(d_block[i].name, name) == 0) {
+            return &d_block[i];
+        }
+    }
+    if (d_block_count >= DELTA_MAX_DEVICES) {
+        return NULL;
+    }
+    snprintf(d_block[d_block_count].name, sizeof(d_block[0].name), "%s", name);
+    return &d_block[d_block_count++];
+}
+
+static struct delta_net_slot *delta_net_lookup(const char *name)
+{
+    for (int i = 0; i < d_net_count; i++) {
+        if (strcmp(d_net[i].name, name) == 0) {
+            return &d_net[i];
+        }
+    }
+    if (d_net_count >= DELTA_MAX_DEVICES) {
+        return NULL;
+    }
+    snprintf(d_net[d_net_count].name, sizeof(d_net[0].name), "%s", name);
+    return &d_net[d_net_count++];
+}
+
+// ============================================================================
+// Scrape execution
+// ============================================================================
+
+// Caches shared by the metric classes; opened once at startup
+struct scraper_state {
+    struct block_device_cache blk_cache;
+    struct net_dev_cache net_cache;
+    struct proc_scrape_cache proc_cache;
+    struct tcp_scrape_cache tcp_cache;
+    int proc_cache_ok;
+    int tcp_cache_ok;
+};
+
+static void run_metric_class(struct scraper_state *st, int cls,
+                             uint64_t timestamp, uint64_t now)
+{
+    switch (cls) {
+    case CLASS_MEMINFO: {
+        struct meminfo_metrics meminfo;
+        if (st->proc_cache_ok ? read_proc_meminfo_cached(&st->proc_cache, &meminfo) == 0
+                              : read_proc_meminfo(&meminfo) == 0) {
+            if (delta_should_emit(&d_meminfo_e, &d_meminfo_prev, &meminfo,
+                                  sizeof(meminfo), now)) {
+                print_meminfo_json(&meminfo, timestamp);
+            }
         } else {
             fprintf(stderr, "WARNING: failed to read meminfo\n");
         }
-
-        // Collect and emit loadavg metrics
-        if (read_proc_loadavg(&loadavg) == 0) {
-            print_loadavg_json(&loadavg, timestamp);
+        break;
+    }
+    case CLASS_LOADAVG: {
+        struct loadavg_metrics loadavg;
+        if (st->proc_cache_ok ? read_proc_loadavg_cached(&st->proc_cache, &loadavg) == 0
+                              : read_proc_loadavg(&loadavg) == 0) {
+            if (delta_should_emit(&d_loadavg_e, &d_loadavg_prev, &loadavg,
+                                  sizeof(loadavg), now)) {
+                print_loadavg_json(&loadavg, timestamp);
+            }
         } else {
             fprintf(stderr, "WARNING: failed to read loadavg\n");
         }
-
-        // Discover block devices (do this every iteration to catch new devices)
-        if (discover_block_devices(&block_devices, &block_device_count) == 0) {
-            // Collect and emit block stats for each device
-            for (int i = 0; i < block_device_count; i++) {
-                struct block_stats stats;
-                if (read_block_stats(block_devices[i], &stats) == 0) {
-                    print_block_stats_json(block_devices[i], &stats, timestamp);
+        break;
+    }
+    case CLASS_BLOCK:
+        // Scrape from the cached inventory, rebuilding it only after a
+        // hotplug event
+        block_device_cache_refresh(&st->blk_cache);
+        for (int i = 0; i < st->blk_cache.count; i++) {
+            struct block_device_entry *entry = &st->blk_cache.entries[i];
+            if (read_block_stats_fd(entry->stat_fd, &entry->stats) == 0) {
+                struct delta_block_slot *slot = delta_block_lookup(entry->name);
+                if (!slot || delta_should_emit(&slot->e, &slot->prev, &entry->stats,
+                                               sizeof(entry->stats), now)) {
+                    print_block_stats_json(entry->name, &entry->stats, timestamp);
                 }
-                // Silently skip devices without stats (e.g., partitions)
             }
-            free_block_devices(block_devices, block_device_count);
-            block_devices = NULL;
-            block_device_count = 0;
-        } else {
-            fprintf(stderr, "WARNING: failed to discover block devices\n");
+            // Silently skip devices without stats (e.g., partitions)
         }
-
-        // Collect and emit network interface metrics
-        struct interface_stats *interfaces = NULL;
-        int interface_count = 0;
-        if (read_net_dev(&interfaces, &interface_count) == 0) {
-            for (int i = 0; i < interface_count; i++) {
-                print_interface_stats_json(&interfaces[i], timestamp);
+        break;
+    case CLASS_NET:
+        if (read_net_dev_cached(&st->net_cache) == 0) {
+            for (int i = 0; i < st->net_cache.count; i++) {
+                struct interface_stats *iface = &st->net_cache.interfaces[i];
+                struct delta_net_slot *slot = delta_net_lookup(iface->name);
+                if (!slot || delta_should_emit(&slot->e, &slot->prev, iface,
+                                               sizeof(*iface), now)) {
+                    print_interface_stats_json(iface, timestamp);
+                }
             }
-            free_interface_stats(interfaces, interface_count);
         } else {
             fprintf(stderr, "WARNING: failed to read network interfaces\n");
         }
-
-        // Collect and emit TCP connection stats
+        break;
+    case CLASS_TCP: {
         struct tcp_stats tcp_stats;
-        if (read_tcp_stats(&tcp_stats) == 0) {
-            print_tcp_stats_json(&tcp_stats, timestamp);
+        if (st->tcp_cache_ok ? read_tcp_stats_cached(&st->tcp_cache, &tcp_stats) == 0
+                             : read_tcp_stats(&tcp_stats) == 0) {
+            if (delta_should_emit(&d_tcp_e, &d_tcp_prev, &tcp_stats,
+                                  sizeof(tcp_stats), now)) {
+                print_tcp_stats_json(&tcp_stats, timestamp);
+            }
         } else {
             fprintf(stderr, "WARNING: failed to read TCP stats\n");
         }
-
-        // Collect and emit TCP retransmit stats
+        break;
+    }
+    case CLASS_RETRANS: {
         struct tcp_retransmit_stats retrans_stats;
-        if (read_tcp_retransmits(&retrans_stats) == 0) {
-            print_tcp_retransmit_json(&retrans_stats, timestamp);
+        if (st->tcp_cache_ok ? read_tcp_retransmits_cached(&st->tcp_cache, &retrans_stats) == 0
+                             : read_tcp_retransmits(&retrans_stats) == 0) {
+            if (delta_should_emit(&d_retrans_e, &d_retrans_prev, &retrans_stats,
+                                  sizeof(retrans_stats), now)) {
+                print_tcp_retransmit_json(&retrans_stats, timestamp);
+            }
         } else {
             fprintf(stderr, "WARNING: failed to read TCP retransmit stats\n");
         }
+        break;
+    }
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "  --interval CLASS=MS    Poll interval for one metric class (default %dms);\n"
+            "                         classes: meminfo loadavg block net tcp retrans\n"
+            "                         (repeatable, e.g. --interval meminfo=250 --interval tcp=10000)\n"
+            "  --delta                Suppress records whose counters are unchanged since\n"
+            "                         the previous sample; every record still ships a full\n"
+            "                         keyframe periodically so consumers can resync\n"
+            "  --keyframe-interval S  Keyframe period for --delta (default %ds)\n"
+            "  --compress CODEC       Compress the stdout stream (codec: zstd); each tick's\n"
+            "                         records form one frame, decodable incrementally\n"
+            "  --realtime             Lock all memory and prefault the stack so the\n"
+            "                         scraper never page-faults under pressure\n"
+            "  --rt-cpu N             Pin to housekeeping core N (implies --realtime)\n"
+            "  --rt-fifo PRIO         Elevate to SCHED_FIFO at PRIO 1-99 (implies --realtime)\n"
+            "  --stats-socket PATH    Serve a JSON snapshot of the daemon's own hot-path\n"
+            "                         latency histograms per connection at PATH\n"
+            "\n"
+            "Runtime control: SIGUSR1 halves all intervals (%dms floor) for\n"
+            "incident-time resolution, SIGUSR2 restores the configured cadence.\n",
+            prog, DEFAULT_INTERVAL_MS, DEFAULT_KEYFRAME_SEC, MIN_INTERVAL_MS);
+}
+
+int main(int argc, char **argv)
+{
+    struct scraper_state st = {.net_cache = {0}};
+    struct itimerspec its = {0};
+    uint64_t expirations;
+    uint64_t now;
+    int tfd;
+    int opt;
+    int realtime_mode = 0;
+    int rt_cpu = -1;
+    int rt_fifo = 0;
+    const char *compress_codec = NULL;
+    const char *stats_socket = NULL;
+
+    static const struct option long_opts[] = {
+        {"interval", required_argument, NULL, 'i'},
+        {"delta", no_argument, NULL, 'd'},
+        {"keyframe-interval", required_argument, NULL, 'k'},
+        {"compress", required_argument, NULL, 'z'},
+        {"stats-socket", required_argument, NULL, 'U'},
+        {"realtime", no_argument, NULL, 'R'},
+        {"rt-cpu", required_argument, NULL, 'A'},
+        {"rt-fifo", required_argument, NULL, 'F'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        sched_table[i].configured_ns = (uint64_t)DEFAULT_INTERVAL_MS * 1000000ULL;
+    }
+
+    while ((opt = getopt_long(argc, argv, "i:dh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'i':
+            if (parse_interval_spec(optarg) != 0) {
+                return 1;
+            }
+            break;
+        case 'd':
+            delta_mode = 1;
+            break;
+        case 'k': {
+            long sec = atol(optarg);
+            if (sec <= 0) {
+                fprintf(stderr, "ERROR: --keyframe-interval must be positive\n");
+                return 1;
+            }
+            keyframe_interval_ns = (uint64_t)sec * 1000000000ULL;
+            break;
+        }
+        case 'z':
+            compress_codec = optarg;
+            break;
+        case 'U':
+            stats_socket = optarg;
+            break;
+        case 'R':
+            realtime_mode = 1;
+            break;
+        case 'A':
+            rt_cpu = atoi(optarg);
+            if (rt_cpu < 0) {
+                fprintf(stderr, "ERROR: --rt-cpu must be a CPU number\n");
+                return 1;
+            }
+            break;
+        case 'F':
+            rt_fifo = atoi(optarg);
+            if (rt_fifo < 1 || rt_fifo > 99) {
+                fprintf(stderr, "ERROR: --rt-fifo must be 1-99\n");
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rt_cpu >= 0 || rt_fifo > 0) {
+        realtime_mode = 1;
+    }
+    if (realtime_mode && realtime_enter(rt_cpu, rt_fifo) != 0) {
+        return 1;
+    }
+
+    // Route the print_*_json() helpers through a batched writer so the
+    // records of one tick flush together (one compressed frame each)
+    if (wire_writer_init(&wire, STDOUT_FILENO, WIRE_FORMAT_JSON, 0, 0) < 0) {
+        fprintf(stderr, "ERROR: failed to initialize output writer\n");
+        return 1;
+    }
+    if (compress_codec && wire_writer_enable_compression(&wire, compress_codec) != 0) {
+        return 1;
+    }
+    wire_set_line_sink(&wire);
+
+    // Self-instrumentation: histogram the scrape cycle and expose it
+    // (with the wire writer's flush stalls) on the stats socket
+    hotpath_register(&scrape_hist, "scrape_cycle");
+    if (stats_socket && hotpath_stats_listen(stats_socket) != 0) {
+        return 1;
+    }
+
+    // Set up signal handlers for graceful shutdown and rate control
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+    signal(SIGUSR1, sigusr1_handler);
+    signal(SIGUSR2, sigusr2_handler);
+
+    fprintf(stderr, "KernelSight AI - Sysfs/Procfs Scraper Daemon\n");
+    fprintf(stderr, "Poll intervals:");
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        fprintf(stderr, " %s=%lums", sched_table[i].name,
+                (unsigned long)(sched_table[i].configured_ns / 1000000ULL));
+    }
+    fprintf(stderr, "\nJSON output will be written to stdout.\n\n");
+
+    tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (tfd < 0) {
+        perror("ERROR: timerfd_create");
+        return 1;
+    }
+
+    // Build the block device inventory once; a hotplug event on /sys/block
+    // triggers the rebuild instead of rescanning every tick
+    if (block_device_cache_init(&st.blk_cache) != 0) {
+        fprintf(stderr, "WARNING: failed to build block device inventory\n");
+    }
+
+    // Open the /proc sources once; every tick re-reads them via pread()
+    // instead of paying path resolution and stdio setup per poll
+    st.proc_cache_ok = (proc_scrape_cache_init(&st.proc_cache) == 0);
+    st.tcp_cache_ok = (tcp_scrape_cache_init(&st.tcp_cache) == 0);
+
+    // All classes start due immediately
+    now = get_monotonic_ns();
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        sched_table[i].interval_ns = sched_table[i].configured_ns;
+        sched_table[i].deadline_ns = now;
+    }
+
+    while (running) {
+        uint64_t timestamp;
+        uint64_t next_deadline;
+
+        if (speed_up) {
+            speed_up = 0;
+            for (int i = 0; i < CLASS_COUNT; i++) {
+                uint64_t halved = sched_table[i].interval_ns / 2;
+                uint64_t floor_ns = (uint64_t)MIN_INTERVAL_MS * 1000000ULL;
+                sched_table[i].interval_ns = halved < floor_ns ? floor_ns : halved;
+            }
+            fprintf(stderr, "Intervals halved (SIGUSR1); SIGUSR2 restores\n");
+        }
+        if (restore_rate) {
+            restore_rate = 0;
+            for (int i = 0; i < CLASS_COUNT; i++) {
+                sched_table[i].interval_ns = sched_table[i].configured_ns;
+            }
+            fprintf(stderr, "Intervals restored to configured cadence (SIGUSR2)\n");
+        }
+
+        // Run everything that is due, advancing each deadline by its
+        // interval; skip forward (not burst) if a scrape overran
+        now = get_monotonic_ns();
+        timestamp = get_timestamp_ns();
+        uint64_t hp_start = hotpath_cycles();
+        int scraped = 0;
+        for (int i = 0; i < CLASS_COUNT; i++) {
+            if (sched_table[i].deadline_ns <= now) {
+                run_metric_class(&st, i, timestamp, now);
+                scraped++;
+                do {
+                    sched_table[i].deadline_ns += sched_table[i].interval_ns;
+                } while (sched_table[i].deadline_ns <= now);
+            }
+        }
+        if (scraped > 0) {
+            hotpath_record(&scrape_hist, hp_start);
+        }
+
+        // Ship this tick's records; output latency is bounded by the
+        // tick cadence, not by buffer fill
+        wire_flush(&wire);
+
+        // Sleep until the earliest deadline (absolute, so no drift)
+        next_deadline = sched_table[0].deadline_ns;
+        for (int i = 1; i < CLASS_COUNT; i++) {
+            if (sched_table[i].deadline_ns < next_deadline) {
+                next_deadline = sched_table[i].deadline_ns;
+            }
+        }
+
+        its.it_value.tv_sec = next_deadline / 1000000000ULL;
+        its.it_value.tv_nsec = next_deadline % 1000000000ULL;
+        if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+            perror("ERROR: timerfd_settime");
+            break;
+        }
 
-        // Sleep for 1 second
-        sleep(1);
+        // EINTR here is a signal arriving; loop around to process it
+        if (read(tfd, &expirations, sizeof(expirations)) < 0 && !running) {
+            break;
+        }
     }
 
     fprintf(stderr, "\nShutting down gracefully...\n");
 
+    close(tfd);
+    block_device_cache_destroy(&st.blk_cache);
+    net_dev_cache_destroy(&st.net_cache);
+    if (st.proc_cache_ok) {
+        proc_scrape_cache_destroy(&st.proc_cache);
+    }
+    if (st.tcp_cache_ok) {
+        tcp_scrape_cache_destroy(&st.tcp_cache);
+    }
+    hotpath_stats_close();
+    wire_set_line_sink(NULL);
+    wire_writer_destroy(&wire);
+
     return 0;
 }
@@ -4,10 +4,15 @@
 // Sysfs scraper implementation
 
 #include "sysfs_scraper.h"
+#include "../common/json_writer.h"
+#include "../common/wire.h"
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 #define SYS_BLOCK_DIR "/sys/block"
 
@@ -111,14 +116,32 @@ int read_block_stats(const char *device, struct block_stats *stats)
 
 void print_block_stats_json(const char *device, const struct block_stats *stats, uint64_t timestamp)
 {
-    printf("{\"timestamp\":%lu,\"type\":\"blockstats\",\"device\":\"%s\",\"data\":{\"read_ios\":%"
-           "lu,\"read_merges\":%lu,\"read_sectors\":%lu,\"read_ticks_ms\":%lu,\"write_ios\":%lu,"
-           "\"write_merges\":%lu,\"write_sectors\":%lu,\"write_ticks_ms\":%lu,\"in_flight\":%lu,"
-           "\"io_ticks_ms\":%lu,\"time_in_queue_ms\":%lu}}\n",
-           timestamp, device, stats->read_ios, stats->read_merges, stats->read_sectors,
-           stats->read_ticks, stats->write_ios, stats->write_merges, stats->write_sectors,
-           stats->write_ticks, stats->in_flight, stats->io_ticks, stats->time_in_queue);
-    fflush(stdout);
+    char line[512];
+    struct json_writer jw;
+
+    json_writer_init(&jw, line, sizeof(line));
+    json_obj_begin(&jw, NULL);
+    json_u64(&jw, "timestamp", timestamp);
+    json_str(&jw, "type", "blockstats");
+    json_str(&jw, "device", device);
+    json_obj_begin(&jw, "data");
+    json_u64(&jw, "read_ios", stats->read_ios);
+    json_u64(&jw, "read_merges", stats->read_merges);
+    json_u64(&jw, "read_sectors", stats->read_sectors);
+    json_u64(&jw, "read_ticks_ms", stats->read_ticks);
+    json_u64(&jw, "write_ios", stats->write_ios);
+    json_u64(&jw, "write_merges", stats->write_merges);
+    json_u64(&jw, "write_sectors", stats->write_sectors);
+    json_u64(&jw, "write_ticks_ms", stats->write_ticks);
+    json_u64(&jw, "in_flight", stats->in_flight);
+    json_u64(&jw, "io_ticks_ms", stats->io_ticks);
+    json_u64(&jw, "time_in_queue_ms", stats->time_in_queue);
+    json_obj_end(&jw);
+    json_obj_end(&jw);
+    int len = json_writer_finish(&jw);
+    if (len > 0) {
+        wire_emit_line(line, (size_t)len);
+    }
 }
 
 void free_block_devices(char **devices, int count)
@@ -132,3 +155,145 @@ void free_block_devices(char **devices, int count)
     }
     free(devices);
 }
+
+// Close held fds and free the entry array (keeps the inotify watch)
+static void cache_drop_entries(struct block_device_cache *cache)
+{
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].stat_fd >= 0) {
+            close(cache->entries[i].stat_fd);
+        }
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->count = 0;
+}
+
+// Build the entry array from the current /sys/block contents, opening each
+// device's stat file once
+static int cache_build_entries(struct block_device_cache *cache)
+{
+    char **devices = NULL;
+    int count = 0;
+
+    if (discover_block_devices(&devices, &count) != 0) {
+        return -1;
+    }
+
+    cache->entries = calloc(count, sizeof(struct block_device_entry));
+    if (!cache->entries) {
+        free_block_devices(devices, count);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct block_device_entry *entry = &cache->entries[i];
+        char path[512];
+
+        snprintf(entry->name, sizeof(entry->name), "%s", devices[i]);
+        snprintf(path, sizeof(path), "%s/%s/stat", SYS_BLOCK_DIR, devices[i]);
+
+        // Some devices have no stat file (e.g., partitions) - keep -1
+        entry->stat_fd = open(path, O_RDONLY);
+    }
+    cache->count = count;
+
+    free_block_devices(devices, count);
+    return 0;
+}
+
+int block_device_cache_init(struct block_device_cache *cache)
+{
+    if (!cache) {
+        return -1;
+    }
+
+    cache->entries = NULL;
+    cache->count = 0;
+
+    // Non-blocking so refresh can poll for hotplug events without waiting
+    cache->inotify_fd = inotify_init1(IN_NONBLOCK);
+    if (cache->inotify_fd >= 0) {
+        if (inotify_add_watch(cache->inotify_fd, SYS_BLOCK_DIR,
+                              IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+            close(cache->inotify_fd);
+            cache->inotify_fd = -1;
+        }
+    }
+
+    if (cache->inotify_fd < 0) {
+        fprintf(stderr, "WARNING: inotify unavailable, rescanning %s every interval\n",
+                SYS_BLOCK_DIR);
+    }
+
+    return cache_build_entries(cache);
+}
+
+int block_device_cache_refresh(struct block_device_cache *cache)
+{
+    if (!cache) {
+        return -1;
+    }
+
+    if (cache->inotify_fd >= 0) {
+        // Drain pending events; any of them invalidates the inventory
+        char buf[4096];
+        int changed = 0;
+
+        while (read(cache->inotify_fd, buf, sizeof(buf)) > 0) {
+            changed = 1;
+        }
+        if (!changed) {
+            return 0;
+        }
+        fprintf(stderr, "Block device change detected, rebuilding inventory\n");
+    }
+
+    // Hotplug event (or no inotify): rebuild from scratch
+    cache_drop_entries(cache);
+    return cache_build_entries(cache);
+}
+
+int read_block_stats_fd(int fd, struct block_stats *stats)
+{
+    char buf[512];
+    ssize_t len;
+
+    if (fd < 0 || !stats) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    // pread from offset 0 re-reads the file without open/close churn
+    len = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    int ret =
+        sscanf(buf, "%lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu", &stats->read_ios,
+               &stats->read_merges, &stats->read_sectors, &stats->read_ticks, &stats->write_ios,
+               &stats->write_merges, &stats->write_sectors, &stats->write_ticks, &stats->in_flight,
+               &stats->io_ticks, &stats->time_in_queue);
+
+    if (ret != 11) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void block_device_cache_destroy(struct block_device_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    cache_drop_entries(cache);
+    if (cache->inotify_fd >= 0) {
+        close(cache->inotify_fd);
+        cache->inotify_fd = -1;
+    }
+}
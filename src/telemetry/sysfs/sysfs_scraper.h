@@ -56,4 +56,49 @@ void print_block_stats_json(const char *device, const struct block_stats *stats,
  */
 void free_block_devices(char **devices, int count);
 
+// Cached block device inventory for periodic scrapers. The inventory is
+// built once: each device's stat file is held open with a preallocated
+// stats slot, and the list is rebuilt only when an inotify watch on
+// /sys/block reports a hotplug event (or on every refresh if inotify is
+// unavailable).
+struct block_device_entry {
+    char name[64];            // Device name (e.g., "sda")
+    int stat_fd;              // Open fd for /sys/block/[name]/stat (-1 if none)
+    struct block_stats stats; // Preallocated scratch for each scrape
+};
+
+struct block_device_cache {
+    struct block_device_entry *entries;
+    int count;
+    int inotify_fd; // Watch on /sys/block (-1 if inotify unavailable)
+};
+
+/**
+ * Build the cached inventory and set up the inotify watch
+ * @param cache Cache to initialize
+ * @return 0 on success, -1 on error
+ */
+int block_device_cache_init(struct block_device_cache *cache);
+
+/**
+ * Rebuild the inventory if a hotplug event arrived since the last call
+ * @param cache Initialized cache
+ * @return 0 on success (rebuilt or unchanged), -1 on rebuild error
+ */
+int block_device_cache_refresh(struct block_device_cache *cache);
+
+/**
+ * Read block statistics from an already-open stat fd (no open/close per scrape)
+ * @param fd Open fd for a /sys/block/[device]/stat file
+ * @param stats Output structure for block statistics
+ * @return 0 on success, -1 on error
+ */
+int read_block_stats_fd(int fd, struct block_stats *stats);
+
+/**
+ * Close all held fds and free the inventory
+ * @param cache Cache to tear down
+ */
+void block_device_cache_destroy(struct block_device_cache *cache);
+
 #endif // SYSFS_SCRAPER_H
@@ -202,10 +202,10 @@ if [ "$LITE_MODE" = true ]; then
     # Start tracers in background
     cd "$BUILD_DIR"
     echo "  Starting eBPF tracers..."
-    sudo ./syscall_tracer > "$LOG_DIR/syscall.log" 2> "$LOG_DIR/syscall_err.log" &
-    sudo ./sched_tracer > "$LOG_DIR/scheduler.log" 2> "$LOG_DIR/scheduler_err.log" &
-    sudo ./page_fault_tracer > "$LOG_DIR/pagefault.log" 2> "$LOG_DIR/pagefault_err.log" &
-    sudo ./io_latency_tracer > "$LOG_DIR/io.log" 2> "$LOG_DIR/io_err.log" &
+    sudo ./syscall_tracer --json > "$LOG_DIR/syscall.log" 2> "$LOG_DIR/syscall_err.log" &
+    sudo ./sched_tracer --json > "$LOG_DIR/scheduler.log" 2> "$LOG_DIR/scheduler_err.log" &
+    sudo ./page_fault_tracer --json > "$LOG_DIR/pagefault.log" 2> "$LOG_DIR/pagefault_err.log" &
+    sudo ./io_latency_tracer --json > "$LOG_DIR/io.log" 2> "$LOG_DIR/io_err.log" &
     ./scraper_daemon > "$LOG_DIR/scraper.log" 2> "$LOG_DIR/scraper_err.log" &
     
     echo -e "${GREEN}✓ All tracers running in background${NC}"
@@ -236,7 +236,7 @@ else
     gnome-terminal --title="Syscall Tracer" --geometry=100x20 -- bash -c "
         cd '$BUILD_DIR'
         echo '=== Syscall Tracer ==='
-        sudo stdbuf -oL ./syscall_tracer 2>'$LOG_DIR/syscall_err.log' | stdbuf -oL tee '$LOG_DIR/syscall.log'
+        sudo stdbuf -oL ./syscall_tracer --json 2>'$LOG_DIR/syscall_err.log' | stdbuf -oL tee '$LOG_DIR/syscall.log'
         echo ''
         read -p 'Press Enter to close...'
     " &
@@ -246,7 +246,7 @@ else
     gnome-terminal --title="Scheduler Tracer" --geometry=100x20 -- bash -c "
         cd '$BUILD_DIR'
         echo '=== Scheduler Tracer ==='
-        sudo stdbuf -oL ./sched_tracer 2>'$LOG_DIR/scheduler_err.log' | stdbuf -oL tee '$LOG_DIR/scheduler.log'
+        sudo stdbuf -oL ./sched_tracer --json 2>'$LOG_DIR/scheduler_err.log' | stdbuf -oL tee '$LOG_DIR/scheduler.log'
         echo ''
         read -p 'Press Enter to close...'
     " &
@@ -256,7 +256,7 @@ else
     gnome-terminal --title="Page Fault Tracer" --geometry=100x20 -- bash -c "
         cd '$BUILD_DIR'
         echo '=== Page Fault Tracer ==='
-        sudo stdbuf -oL ./page_fault_tracer 2>'$LOG_DIR/pagefault_err.log' | stdbuf -oL tee '$LOG_DIR/pagefault.log'
+        sudo stdbuf -oL ./page_fault_tracer --json 2>'$LOG_DIR/pagefault_err.log' | stdbuf -oL tee '$LOG_DIR/pagefault.log'
         echo ''
         read -p 'Press Enter to close...'
     " &
@@ -266,7 +266,7 @@ else
     gnome-terminal --title="IO Latency Tracer" --geometry=100x20 -- bash -c "
         cd '$BUILD_DIR'
         echo '=== I/O Latency Tracer ==='
-        sudo stdbuf -oL ./io_latency_tracer 2>'$LOG_DIR/io_err.log' | stdbuf -oL tee '$LOG_DIR/io.log'
+        sudo stdbuf -oL ./io_latency_tracer --json 2>'$LOG_DIR/io_err.log' | stdbuf -oL tee '$LOG_DIR/io.log'
         echo ''
         read -p 'Press Enter to close...'
     " &